@@ -3,7 +3,13 @@
  * Implements full read/write support for Amiga ADF disk images
  */
 
+// AMIGA_FUSE_LOWLEVEL selects the FUSE 3 low-level (inode) backend; otherwise
+// the FUSE 2.6 high-level path API is used (macFUSE, libfuse 2)
+#ifdef AMIGA_FUSE_LOWLEVEL
+#define FUSE_USE_VERSION 34
+#else
 #define FUSE_USE_VERSION 26
+#endif
 
 #ifndef ADF_DEBUG
 #define ADF_DEBUG 0
@@ -16,13 +22,26 @@
 #endif
 #endif
 
+#ifdef AMIGA_FUSE_LOWLEVEL
+#include <fuse_lowlevel.h>
+#else
 #include <fuse.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 #include <cstdint>
 #include <cctype>
 #include <algorithm>
 #include <array>
 #include <bit>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <fcntl.h>
@@ -35,10 +54,14 @@
 #include <string_view>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <syslog.h>
+#include <thread>
 #include <unistd.h>
 #include <unordered_map>
 #include <vector>
 #include <set>
+#include <shared_mutex>
 #include <limits>
 // #include <csignal>  // not needed if we remove custom handler
 
@@ -54,9 +77,14 @@ constexpr size_t BLOCK_SIZE = 512;
 constexpr size_t BCPL_STRING_MAX = 30;
 constexpr size_t HASH_TABLE_SIZE = 72;
 
+// Backing store for zero-filled spans handed out by the zero-copy read path
+static constexpr std::array<uint8_t, 488> ZERO_PAYLOAD{};
+
 // Block types
 constexpr int32_t T_HEADER = 2;
 constexpr int32_t T_DATA = 8;
+constexpr int32_t T_LIST = 16;
+constexpr int32_t T_DIRCACHE = 33;
 constexpr int32_t ST_ROOT = 1;
 constexpr int32_t ST_DIR = 2;
 constexpr int32_t ST_FILE = -3;
@@ -64,8 +92,17 @@ constexpr int32_t ST_FILE = -3;
 // DOS types
 constexpr uint32_t DOS_FFS = 0x444F5301;
 constexpr uint32_t DOS_FFS_INTL = 0x444F5303;
+constexpr uint32_t DOS_OFS_DC = 0x444F5304;
 constexpr uint32_t DOS_FFS_DC = 0x444F5305;
 
+// RootBlock::bm_flag of a bitmap that matches the directory tree
+constexpr uint32_t BM_VALID = 0xFFFFFFFF;
+
+// Bit n of bitmap page i stands for block BM_FIRST + i * BM_PAGE_BLOCKS + n;
+// the two boot blocks have no bit
+constexpr uint32_t BM_FIRST = 2;
+constexpr uint32_t BM_PAGE_BLOCKS = 127 * 32;
+
 // Endian helpers
 namespace endian {
     template<typename T>
@@ -100,6 +137,140 @@ namespace endian {
     }
 }
 
+// Block checksum kernels: sum of the 128 big-endian words of a block.
+// The widest kernel the CPU supports is picked once, on first use.
+namespace checksum {
+    constexpr size_t WORDS = BLOCK_SIZE / 4;
+
+    inline uint32_t sum_scalar(const uint32_t* data) noexcept {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < WORDS; i++) {
+            sum += endian::from_big_endian(data[i]);
+        }
+        return sum;
+    }
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    __attribute__((target("sse2")))
+    inline uint32_t sum_sse2(const uint32_t* data) noexcept {
+        const __m128i lo_bytes = _mm_set1_epi32(0x00FF00FF);
+        __m128i acc = _mm_setzero_si128();
+        for (size_t i = 0; i < WORDS; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            // bswap32: swap 16-bit halves, then the bytes inside each half
+            v = _mm_shufflelo_epi16(_mm_shufflehi_epi16(v, 0xB1), 0xB1);
+            v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 8), lo_bytes),
+                             _mm_andnot_si128(lo_bytes, _mm_slli_epi16(v, 8)));
+            acc = _mm_add_epi32(acc, v);
+        }
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(acc));
+    }
+
+    __attribute__((target("avx2")))
+    inline uint32_t sum_avx2(const uint32_t* data) noexcept {
+        const __m256i bswap = _mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        for (size_t i = 0; i < WORDS; i += 16) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 8));
+            acc0 = _mm256_add_epi32(acc0, _mm256_shuffle_epi8(a, bswap));
+            acc1 = _mm256_add_epi32(acc1, _mm256_shuffle_epi8(b, bswap));
+        }
+        __m256i acc = _mm256_add_epi32(acc0, acc1);
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+    }
+#define AMIGA_FUSE_SIMD_CHECKSUM 1
+#endif
+
+    using Kernel = uint32_t (*)(const uint32_t*) noexcept;
+
+    inline Kernel select_kernel() noexcept {
+#ifdef AMIGA_FUSE_SIMD_CHECKSUM
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return sum_avx2;
+        if (__builtin_cpu_supports("sse2")) return sum_sse2;
+#endif
+        return sum_scalar;
+    }
+
+    inline uint32_t block_sum(const void* block) noexcept {
+        static const Kernel kernel = select_kernel();
+        return kernel(static_cast<const uint32_t*>(block));
+    }
+}
+
+// Name folding for case-insensitive matching. Plain volumes fold a-z;
+// international ones (DOS\2 to DOS\7) also fold Latin-1 0xE0-0xFE, bar 0xF7.
+namespace text {
+    constexpr std::array<uint8_t, 256> make_fold_table(bool intl) {
+        std::array<uint8_t, 256> table{};
+        for (size_t c = 0; c < table.size(); c++) {
+            bool lower = (c >= 'a' && c <= 'z') ||
+                (intl && c >= 0xE0 && c <= 0xFE && c != 0xF7);
+            table[c] = static_cast<uint8_t>(lower ? c - 0x20 : c);
+        }
+        return table;
+    }
+
+    inline constexpr std::array<uint8_t, 256> PLAIN_FOLD = make_fold_table(false);
+    inline constexpr std::array<uint8_t, 256> INTL_FOLD = make_fold_table(true);
+
+#if defined(__SSE2__)
+    inline void upper16(char* dst, const char* src, bool intl) noexcept {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        // Shift each range to the bottom of the signed bytes so one compare finds it
+        __m128i t = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(128 - 'a')));
+        __m128i lower = _mm_cmplt_epi8(t, _mm_set1_epi8(static_cast<char>(-128 + 26)));
+        if (intl) {
+            __m128i u = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(128 - 0xE0)));
+            __m128i latin = _mm_cmplt_epi8(u, _mm_set1_epi8(static_cast<char>(-128 + 31)));
+            latin = _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(0xF7))), latin);
+            lower = _mm_or_si128(lower, latin);
+        }
+        v = _mm_sub_epi8(v, _mm_and_si128(lower, _mm_set1_epi8(0x20)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), v);
+    }
+#define AMIGA_FUSE_SIMD_FOLD 1
+#elif defined(__ARM_NEON)
+    inline void upper16(char* dst, const char* src, bool intl) noexcept {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src));
+        uint8x16_t lower = vcltq_u8(vsubq_u8(v, vdupq_n_u8('a')), vdupq_n_u8(26));
+        if (intl) {
+            uint8x16_t latin = vcltq_u8(vsubq_u8(v, vdupq_n_u8(0xE0)), vdupq_n_u8(31));
+            latin = vbicq_u8(latin, vceqq_u8(v, vdupq_n_u8(0xF7)));
+            lower = vorrq_u8(lower, latin);
+        }
+        v = vsubq_u8(v, vandq_u8(lower, vdupq_n_u8(0x20)));
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst), v);
+    }
+#define AMIGA_FUSE_SIMD_FOLD 1
+#endif
+
+    // Copies n bytes from src to dst, folding each through the volume's table
+    inline void fold(char* dst, const char* src, size_t n, bool intl) noexcept {
+#ifdef AMIGA_FUSE_SIMD_FOLD
+        if (n >= 16) {
+            for (size_t i = 0; i + 16 <= n; i += 16) upper16(dst + i, src + i, intl);
+            // Folding is idempotent, so the tail can overlap the last chunk
+            if (n % 16) upper16(dst + n - 16, src + n - 16, intl);
+            return;
+        }
+#endif
+        const auto& table = intl ? INTL_FOLD : PLAIN_FOLD;
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = static_cast<char>(table[static_cast<unsigned char>(src[i])]);
+        }
+    }
+}
+
 // BCPL string handling
 class BcplString {
 public:
@@ -122,6 +293,104 @@ public:
     }
 };
 
+// Word-packed in-memory allocation map (bit set = block free)
+class BlockBitmap {
+public:
+    void reset(size_t nbits, bool all_free) {
+        size_ = nbits;
+        words_.assign((nbits + 63) / 64, all_free ? ~uint64_t{0} : 0);
+        // Keep bits past the end clear so scans never report them free
+        if (all_free && (nbits % 64) != 0) {
+            words_.back() &= (uint64_t{1} << (nbits % 64)) - 1;
+        }
+        free_count_ = all_free ? nbits : 0;
+    }
+    
+    size_t size() const { return size_; }
+    size_t free_count() const { return free_count_; }
+    
+    bool is_free(uint32_t block) const {
+        return block < size_ && ((words_[block >> 6] >> (block & 63)) & 1);
+    }
+    
+    void set_free(uint32_t block) {
+        if (block >= size_ || is_free(block)) return;
+        words_[block >> 6] |= uint64_t{1} << (block & 63);
+        ++free_count_;
+    }
+    
+    void set_used(uint32_t block) {
+        if (!is_free(block)) return;
+        words_[block >> 6] &= ~(uint64_t{1} << (block & 63));
+        --free_count_;
+    }
+    
+    // The 32 bits starting at block first, in on-disk bitmap order
+    uint32_t word32(uint32_t first) const {
+        size_t w = first >> 6;
+        unsigned shift = first & 63;
+        uint64_t lo = w < words_.size() ? words_[w] >> shift : 0;
+        uint64_t hi = (shift > 32 && w + 1 < words_.size()) ? words_[w + 1] << (64 - shift) : 0;
+        return static_cast<uint32_t>(lo | hi);
+    }
+    
+    // Marks [start, start + count) used a word at a time
+    void set_used_run(uint32_t start, uint32_t count) {
+        size_t end = std::min<size_t>(size_t{start} + count, size_);
+        for (size_t b = start; b < end; ) {
+            size_t bits = std::min<size_t>(64 - (b & 63), end - b);
+            uint64_t mask = (bits == 64 ? ~uint64_t{0} : ((uint64_t{1} << bits) - 1)) << (b & 63);
+            uint64_t& word = words_[b >> 6];
+            free_count_ -= static_cast<size_t>(std::popcount(word & mask));
+            word &= ~mask;
+            b += bits;
+        }
+    }
+    
+    // First free block at or after `from`, or 0 if none (block 0 is never free)
+    uint32_t find_first_free(uint32_t from = 0) const {
+        return find_next(from, 0);
+    }
+    
+    // First used block at or after `from`, or size() if the rest is free
+    uint32_t find_first_used(uint32_t from) const {
+        uint32_t b = find_next(from, ~uint64_t{0});
+        return b ? b : static_cast<uint32_t>(size_);
+    }
+    
+    // Start of the first run of `count` consecutive free blocks at or after `from`, or 0
+    uint32_t find_free_run(uint32_t count, uint32_t from = 0) const {
+        while (true) {
+            uint32_t start = find_first_free(from);
+            if (start == 0) return 0;
+            uint32_t end = find_first_used(start);
+            if (end - start >= count) return start;
+            if (end >= size_) return 0;
+            from = end;
+        }
+    }
+    
+private:
+    // Scans for the first bit equal to 1 after XOR with `invert` (0 = free, ~0 = used)
+    uint32_t find_next(uint32_t from, uint64_t invert) const {
+        if (from >= size_) return 0;
+        size_t w = from >> 6;
+        uint64_t word = (words_[w] ^ invert) & (~uint64_t{0} << (from & 63));
+        while (true) {
+            if (word) {
+                size_t block = w * 64 + static_cast<size_t>(std::countr_zero(word));
+                return block < size_ ? static_cast<uint32_t>(block) : 0;
+            }
+            if (++w >= words_.size()) return 0;
+            word = words_[w] ^ invert;
+        }
+    }
+    
+    std::vector<uint64_t> words_;
+    size_t size_ = 0;
+    size_t free_count_ = 0;
+};
+
 // Block structures
 #pragma pack(push, 1)
 struct BootBlock {
@@ -168,7 +437,10 @@ struct FileBlock {
     uint32_t first_data;              // 16
     uint32_t checksum;                // 20
     uint32_t data_blocks[HASH_TABLE_SIZE]; // 24 (288 bytes)
-    uint8_t padding1[12];             // 312 to 324
+    uint32_t reserved1;               // 312
+    uint16_t uid;                     // 316
+    uint16_t gid;                     // 318
+    uint32_t protect;                 // 320
     uint32_t file_size;               // 324
     uint8_t comment[80];              // 328
     uint32_t days;                    // 408
@@ -193,15 +465,29 @@ struct DataBlock {
     uint8_t data[488];
 };
 
+// Directory cache block (DOS\4, DOS\5). A directory's extension field
+// points at a chain of these, holding a packed record per entry:
+//   header(4) size(4) protect(4) uid(2) gid(2) days(2) mins(2) ticks(2)
+//   type(1) name_len(1) name comment_len(1) comment, padded to even length
+struct DirCacheBlock {
+    uint32_t type;         // 0   T_DIRCACHE
+    uint32_t header_key;   // 4   this block
+    uint32_t parent;       // 8   directory the records belong to
+    uint32_t records_nb;   // 12
+    uint32_t next_dirc;    // 16
+    uint32_t checksum;     // 20
+    uint8_t records[488];  // 24
+};
+
 struct BitmapBlock {
     uint32_t checksum;
     uint32_t map[127];  // Each bit represents a block
 };
 
+// Continues RootBlock::bm_pages once a volume needs more than 25 bitmap blocks
 struct BitmapExtBlock {
-    uint32_t bitmap_flag;        // 0-3
-    uint32_t next_bitmap;        // 4-7
-    uint32_t bitmap_blocks[126]; // 8-511 (126*4=504 bytes, total 512)
+    uint32_t bm_pages[127];      // 0-507
+    uint32_t bm_ext;             // 508-511, next extension block or 0
 };
 #pragma pack(pop)
 
@@ -210,9 +496,16 @@ static_assert(sizeof(BootBlock) == BLOCK_SIZE, "BootBlock must be 512 bytes");
 static_assert(sizeof(RootBlock) == BLOCK_SIZE, "RootBlock must be 512 bytes");
 static_assert(sizeof(FileBlock) == BLOCK_SIZE, "FileBlock must be 512 bytes");
 static_assert(sizeof(DataBlock) == BLOCK_SIZE, "DataBlock must be 512 bytes");
+static_assert(sizeof(DirCacheBlock) == BLOCK_SIZE, "DirCacheBlock must be 512 bytes");
 static_assert(sizeof(BitmapBlock) == BLOCK_SIZE, "BitmapBlock must be 512 bytes");
 static_assert(sizeof(BitmapExtBlock) == BLOCK_SIZE, "BitmapExtBlock must be 512 bytes");
 
+// Logical-to-physical data block map for one file header
+struct BlockIndex {
+    std::vector<uint32_t> blocks;  // blocks[i] holds payload bytes [i*488, (i+1)*488)
+    bool corrupt = false;          // chain ended on a bad block; tail not indexed
+};
+
 // Directory entry
 struct Entry {
     std::string name;
@@ -220,7 +513,70 @@ struct Entry {
     size_t size;
     time_t mtime;
     uint32_t block_num;
+    uint32_t subdirs = 0;  // directories only
+};
+
+// How scattered file data and free space are; see AdfImage::fragmentation()
+struct FragmentationStats {
+    size_t files = 0;
+    size_t fragmented_files = 0;  // files whose data is in more than one run
+    size_t data_blocks = 0;
+    size_t extents = 0;           // runs of consecutive data blocks, over all files
+    size_t free_extents = 0;
+    size_t largest_free_run = 0;
+};
+
+// Outcome of the background check of the bitmap against the directory tree
+struct ConsistencyStats {
+    bool done = false;
+    size_t headers = 0;      // headers walked
+    size_t blocks = 0;       // blocks found in use by them
+    size_t marked_free = 0;  // in use but free in the bitmap; now marked used
+    size_t unreachable = 0;  // used in the bitmap but owned by nothing
+    size_t cross_linked = 0; // claimed by a header but handed out again since mount
+};
+
+// One live header in the namespace index
+struct Node {
+    uint32_t parent;
+    Entry entry;
+    std::string folded;              // entry.name case-folded, the key in its parent's NameMap
+    uint32_t hash;                   // hash table bucket in the parent directory
+    std::vector<uint32_t> children;  // directories: child headers in listing order
+};
+
+// Folded name -> header block. Transparent, so lookups can probe with a
+// string_view of a stack buffer instead of building a std::string.
+struct NameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const noexcept {
+        return std::hash<std::string_view>{}(name);
+    }
 };
+using NameMap = std::unordered_map<std::string, uint32_t, NameHash, std::equal_to<>>;
+
+// When changes in the mapping are committed to the image file
+enum class Durability {
+    Strict,    // after every create/unlink/rmdir, on close and on fsync (default)
+    Periodic,  // from a background thread every commit_ms, and on fsync
+    OnFsync,   // only on explicit fsync
+    Unmount,   // only at unmount
+};
+
+inline std::optional<Durability> parse_durability(std::string_view name) {
+    if (name == "strict") return Durability::Strict;
+    if (name == "periodic") return Durability::Periodic;
+    if (name == "fsync") return Durability::OnFsync;
+    if (name == "unmount") return Durability::Unmount;
+    return std::nullopt;
+}
+
+// Anything reported after mount goes to syslog as well, since stdout and
+// stderr are gone once FUSE has daemonized
+inline void report(int priority, const std::string& message) {
+    std::cerr << message << "\n";
+    syslog(priority, "%s", message.c_str());
+}
 
 // Main ADF image handler with write support
 class AdfImage {
@@ -234,19 +590,71 @@ private:
     uint32_t root_block_num_ = 0;
     std::string volume_name_;
     bool is_ffs_ = false;
+    bool dircache_ = false;  // DOS\4 / DOS\5: directories carry a dircache chain
+    bool intl_ = false;      // DOS\2 to DOS\7: names fold with the international table
     bool read_only_ = false;
     
-    std::unordered_map<std::string, std::vector<Entry>> dir_cache_;
-    std::set<uint32_t> free_blocks_;
-    std::set<uint32_t> used_blocks_;
-    
-    // Thread safety for FUSE multithreading
-    mutable std::mutex fs_mutex_;
+    // Namespace index: every live header, root included. Built at mount and
+    // kept current by each mutation, so metadata never touches the mapping.
+    std::unordered_map<uint32_t, Node> nodes_;
+    // Name side of the index: directory block -> folded name -> header block
+    std::unordered_map<uint32_t, NameMap> dentries_;
+    std::unordered_map<uint32_t, BlockIndex> block_index_;
+    // Open handles per file header. A file unlinked while open becomes an
+    // orphan and keeps its blocks until the last handle is released.
+    std::unordered_map<uint32_t, uint32_t> open_files_;
+    std::set<uint32_t> orphans_;
+    // Bumped each time a header block is freed, so a reused block number
+    // reaches the kernel as a new inode
+    std::unordered_map<uint32_t, uint64_t> generations_;
+    BlockBitmap free_map_;
+    // Bitmap block for each 4064-block stretch of the volume: the root's 25
+    // bm_pages, then those of the bm_ext chain. Fixed after mount.
+    std::vector<uint32_t> bitmap_pages_;
+    std::vector<bool> bitmap_dirty_;  // per bitmap_pages_ entry, guarded by alloc_mutex_
+    std::vector<uint32_t> bitmap_ext_blocks_;  // the bm_ext chain itself
+    bool bitmap_trusted_ = false;  // bm_flag was valid at mount, so the walk was skipped
+    bool bitmap_walked_ = false;   // the mount rebuilt free_map_ from the whole tree
+    std::set<uint32_t> dirty_blocks_;  // handed out by get_block_writable since last sync
+    
+    // Thread safety for FUSE multithreading. Locks are always taken in this
+    // order, holding at most one stripe from each table:
+    //   fs_mutex_      shared by ordinary ops; exclusive for rmdir, sync and unmount
+    //   dir_locks_     a directory's hash table and the hash_chain links in it
+    //   header_locks_  a header block's words and, for files, its data chain
+    //   dircache_mutex_  every dircache block
+    //   alloc_mutex_   free_map_, bitmap_dirty_ and the on-disk bitmap
+    //   cache_mutex_, dirty_mutex_
+    // Any write to a header block holds its header lock exclusively, since
+    // every field shares the one checksum word.
+    static constexpr size_t LOCK_STRIPES = 64;
+    mutable std::shared_mutex fs_mutex_;
+    mutable std::array<std::shared_mutex, LOCK_STRIPES> dir_locks_;
+    mutable std::array<std::shared_mutex, LOCK_STRIPES> header_locks_;
+    std::mutex dircache_mutex_;
+    mutable std::mutex alloc_mutex_;
+    std::mutex cache_mutex_;  // nodes_, dentries_, block_index_, open_files_, orphans_, generations_
+    std::mutex dirty_mutex_;  // dirty_blocks_
+    
+    Durability durability_ = Durability::Strict;
+    unsigned commit_ms_ = 5000;
+    std::thread commit_thread_;
+    std::condition_variable_any commit_cv_;
+    bool commit_stop_ = false;  // guarded by fs_mutex_
+    
+    std::thread check_thread_;
+    bool check_stop_ = false;  // guarded by fs_mutex_
+    ConsistencyStats check_stats_;  // guarded by alloc_mutex_
+    // Blocks handed out since a trusted mount, which the check may not have
+    // seen; guarded by alloc_mutex_ and empty when no check is pending
+    std::vector<bool> allocated_since_check_;
     
 public:
     explicit AdfImage(std::string_view filename) : filename_(filename) {}
     
     ~AdfImage() {
+        stop_periodic_commit();
+        stop_background_check();
         close();
     }
     
@@ -285,10 +693,34 @@ public:
     }
     
     void close() {
+        std::lock_guard<std::shared_mutex> lock(fs_mutex_);
         if (mapped_data_ && mapped_data_ != MAP_FAILED) {
-            // Sync changes to disk if writeable
+            // Sync changes to disk if writeable. The bitmap written back now
+            // is only vouched for if the whole tree was walked against it,
+            // at mount or by a background check that ran to the end.
             if (!read_only_) {
-                msync(mapped_data_, file_size_, MS_SYNC);
+                // Handles still open now will never be released
+                std::vector<uint32_t> orphans;
+                {
+                    std::lock_guard<std::mutex> cache(cache_mutex_);
+                    orphans.assign(orphans_.begin(), orphans_.end());
+                    orphans_.clear();
+                    open_files_.clear();
+                }
+                for (uint32_t block : orphans) free_file_locked(block);
+                
+                flush_dirty_pages();
+                bool checked;
+                {
+                    std::lock_guard<std::mutex> alloc(alloc_mutex_);
+                    checked = bitmap_walked_ || check_stats_.done;
+                }
+                // Only once the pages it vouches for are on disk, so a crash
+                // in between leaves the flag clear rather than a stale bitmap
+                if (checked) {
+                    set_bitmap_flag(BM_VALID);
+                    msync_block(root_block_num_);
+                }
             }
             munmap(mapped_data_, file_size_);
             mapped_data_ = nullptr;
@@ -312,8 +744,56 @@ public:
     }
     
     size_t free_blocks_count() const {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
-        return free_blocks_.size();
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        std::lock_guard<std::mutex> alloc(alloc_mutex_);
+        return free_map_.free_count();
+    }
+    
+    // Walks every file's data chain and the free map. Costs a read of each
+    // data block, so it is only run on request (-o fragstats).
+    FragmentationStats fragmentation() {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        FragmentationStats stats;
+        
+        std::vector<uint32_t> files;
+        {
+            std::lock_guard<std::mutex> cache(cache_mutex_);
+            for (const auto& [block, node] : nodes_) {
+                if (!node.entry.is_directory) files.push_back(block);
+            }
+        }
+        
+        for (uint32_t file : files) {
+            std::shared_lock<std::shared_mutex> header(header_lock(file));
+            const auto* fb = get_block<FileBlock>(file);
+            if (!fb) continue;
+            
+            size_t extents = 0;
+            uint32_t prev = 0;
+            uint32_t cur = endian::from_big_endian(fb->first_data);
+            // Bounded by the disk size so a looped chain cannot spin forever
+            for (size_t n = 0; cur != 0 && n < total_blocks(); n++) {
+                const auto* db = get_block<DataBlock>(cur);
+                if (!db) break;
+                if (cur != prev + 1) extents++;
+                stats.data_blocks++;
+                prev = cur;
+                cur = endian::from_big_endian(db->next_data);
+            }
+            stats.files++;
+            stats.extents += extents;
+            if (extents > 1) stats.fragmented_files++;
+        }
+        
+        std::lock_guard<std::mutex> alloc(alloc_mutex_);
+        uint32_t from = 0;
+        while (uint32_t start = free_map_.find_first_free(from)) {
+            uint32_t end = free_map_.find_first_used(start);
+            stats.free_extents++;
+            stats.largest_free_run = std::max<size_t>(stats.largest_free_run, end - start);
+            from = end;
+        }
+        return stats;
     }
     
     template<typename T>
@@ -331,6 +811,10 @@ public:
         if (!is_valid() || read_only_ || (block_num + 1ull) * BLOCK_SIZE > file_size_) {
             return nullptr;
         }
+        {
+            std::lock_guard<std::mutex> lock(dirty_mutex_);
+            dirty_blocks_.insert(block_num);
+        }
         return reinterpret_cast<T*>(
             static_cast<uint8_t*>(mapped_data_) + block_num * BLOCK_SIZE
         );
@@ -338,12 +822,8 @@ public:
     
     uint32_t calculate_checksum(const void* block, uint32_t checksum_offset = 5) {
         const uint32_t* data = static_cast<const uint32_t*>(block);
-        uint32_t sum = 0;
-        for (int i = 0; i < 128; i++) {
-            if (i != checksum_offset) { // Skip checksum field itself
-                sum += endian::from_big_endian(data[i]);
-            }
-        }
+        // Sum every word, then take the checksum field itself back out
+        uint32_t sum = checksum::block_sum(block) - endian::from_big_endian(data[checksum_offset]);
         return -sum;
     }
     
@@ -358,6 +838,17 @@ public:
         update_checksum(bitmap, 0); // Bitmap checksum is at offset 0
     }
     
+    // Stores a native value into a big-endian word of a block whose checksum
+    // is currently valid. The Amiga checksum is a plain additive sum, so it is
+    // patched by (old - new) instead of re-summing all 128 words.
+    void set_checksummed(void* block, uint32_t& field, uint32_t value, uint32_t checksum_offset = 5) {
+        uint32_t* data = static_cast<uint32_t*>(block);
+        uint32_t old_value = endian::from_big_endian(field);
+        field = endian::to_big_endian(value);
+        uint32_t checksum = endian::from_big_endian(data[checksum_offset]);
+        data[checksum_offset] = endian::to_big_endian(checksum + old_value - value);
+    }
+    
     bool parse_filesystem() {
         const auto* boot = get_block<BootBlock>(0);
         if (!boot) return false;
@@ -370,6 +861,9 @@ public:
         if (root_block_num_ <= 1) return false;      // sanity check
         
         is_ffs_ = (dos_type_ == DOS_FFS || dos_type_ == DOS_FFS_INTL || dos_type_ == DOS_FFS_DC);
+        dircache_ = (dos_type_ == DOS_OFS_DC || dos_type_ == DOS_FFS_DC);
+        uint32_t flavour = dos_type_ & 0xFF;
+        intl_ = ((dos_type_ & 0xFFFFFF00) == 0x444F5300 && flavour >= 2 && flavour <= 7);
         
         // Validate DOS type but still use standard geometry
         if ((dos_type_ & 0xFFFFFF00) != 0x444F5300) {
@@ -419,43 +913,33 @@ public:
         
         // Parse bitmap to find free blocks
         parse_bitmap();
+        build_index();
         
         return true;
     }
     
     void parse_bitmap() {
-        free_blocks_.clear();
-        used_blocks_.clear();
-        
         // Initially mark all blocks as free
         uint32_t total_blocks = file_size_ / BLOCK_SIZE;
-        for (uint32_t i = 2; i < total_blocks; i++) {
-            free_blocks_.insert(i);
-        }
+        free_map_.reset(total_blocks, true);
         
         // Mark system blocks as used
-        used_blocks_.insert(0); // Boot block
-        used_blocks_.insert(1); // Boot block
-        free_blocks_.erase(0);
-        free_blocks_.erase(1);
-        // Don't mark root_block here - let scan_used_blocks find it
+        free_map_.set_used(0); // Boot block
+        free_map_.set_used(1); // Boot block
         
         // Parse the actual bitmap
-        const auto* root = get_block<RootBlock>(root_block_num_);
-        if (!root) return;
+        load_bitmap_pages();
+        bitmap_dirty_.assign(bitmap_pages_.size(), false);
         
-        for (int i = 0; i < 25; i++) {
-            uint32_t bm_block = endian::from_big_endian(root->bm_pages[i]);
-            if (bm_block == 0) break;
-            
-            used_blocks_.insert(bm_block);
-            free_blocks_.erase(bm_block);
+        for (size_t i = 0; i < bitmap_pages_.size(); i++) {
+            uint32_t bm_block = bitmap_pages_[i];
+            free_map_.set_used(bm_block);
             
             const auto* bitmap = get_block<BitmapBlock>(bm_block);
             if (!bitmap) continue;
             
-            // Each bitmap block covers 127 * 32 = 4064 blocks
-            uint32_t base_block = i * 4064;
+            // Each bitmap block covers 127 * 32 = 4064 blocks, counted from block 2
+            uint32_t base_block = static_cast<uint32_t>(BM_FIRST + i * BM_PAGE_BLOCKS);
             
             for (int j = 0; j < 127; j++) {
                 uint32_t map_word = endian::from_big_endian(bitmap->map[j]);
@@ -465,8 +949,7 @@ public:
                     
                     if (!(map_word & (1u << bit))) {
                         // Bit clear = block used
-                        used_blocks_.insert(block_num);
-                        free_blocks_.erase(block_num);
+                        free_map_.set_used(block_num);
                     }
                 }
             }
@@ -474,97 +957,128 @@ public:
         
         // Also mark blocks used by directory structure: mark root as used,
         // then walk every hash bucket so we don't short-circuit on "used root".
-        used_blocks_.insert(root_block_num_);
-        free_blocks_.erase(root_block_num_);
+        free_map_.set_used(root_block_num_);
         
         const auto* root2 = get_block<RootBlock>(root_block_num_);
         if (!root2) return;
-        for (int i = 0; i < HASH_TABLE_SIZE; ++i) {
-            uint32_t hb = endian::from_big_endian(root2->hash_table[i]);
-            if (hb) scan_used_blocks(hb);
-        }
-    }
-    
-    void scan_used_blocks(uint32_t block_num) {
-        if (block_num == 0 || used_blocks_.count(block_num)) return;
-        
-        used_blocks_.insert(block_num);
-        free_blocks_.erase(block_num);
-        
-        const auto* block = get_block<FileBlock>(block_num);
-        if (!block) return;
         
-        int32_t sec_type = endian::from_big_endian(block->sec_type);
+        // A bitmap the last writer left marked valid is taken as is; the
+        // background check walks the tree against it once FUSE is up
+        bitmap_trusted_ = endian::from_big_endian(root2->bm_flag) == BM_VALID &&
+                          BM_FIRST + bitmap_pages_.size() * BM_PAGE_BLOCKS >= total_blocks;
+        if (!read_only_) {
+            // Until we commit at unmount the on-disk bitmap may lag behind
+            // the blocks in use, so AmigaDOS and our next mount must not trust it
+            set_bitmap_flag(0);
+            msync_block(root_block_num_);
+        }
+        if (bitmap_trusted_) {
+            // Tracked from here rather than from when the check starts, so
+            // any block handed out before it reaches its old owner is seen
+            allocated_since_check_.assign(total_blocks, false);
+            return;
+        }
         
-        // Scan hash table for directories (also accept 0 for root)
-        if (sec_type == ST_ROOT || sec_type == 0 || sec_type == ST_DIR) {
-            // For root block, use RootBlock structure
+        mark_reachable_used();
+        bitmap_walked_ = true;
+        
+        // The walk may have found blocks the disk has free; re-encode every
+        // page at the next commit so the bitmap flagged valid then is right
+        bitmap_dirty_.assign(bitmap_pages_.size(), true);
+    }
+    
+    // Marks used every block reachable from the root: headers through the
+    // hash tables and chains, and whatever owned_blocks() finds under each.
+    // Visited blocks are tracked apart from free_map_, which still holds the
+    // untrusted bitmap; a block it already has in use says nothing about
+    // the blocks hanging off it, e.g. data appended after the last commit.
+    void mark_reachable_used() {
+        std::vector<bool> visited(total_blocks(), false);
+        std::vector<uint32_t> pending{root_block_num_};
+        while (!pending.empty()) {
+            uint32_t block_num = pending.back();
+            pending.pop_back();
+            if (block_num == 0 || block_num >= visited.size() || visited[block_num]) continue;
+            visited[block_num] = true;
+            free_map_.set_used(block_num);
+            
+            const auto* block = get_block<FileBlock>(block_num);
+            if (!block || endian::from_big_endian(block->type) != static_cast<uint32_t>(T_HEADER)) continue;
+            
+            for (uint32_t owned : owned_blocks(block_num)) {
+                if (owned < visited.size()) free_map_.set_used(owned);
+            }
+            
+            int32_t sec_type = endian::from_big_endian(block->sec_type);
             if (block_num == root_block_num_) {
                 const auto* root = get_block<RootBlock>(block_num);
-                if (root) {
-                    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-                        uint32_t hash_block = endian::from_big_endian(root->hash_table[i]);
-                        if (hash_block != 0) {
-                            scan_used_blocks(hash_block);
-                        }
-                    }
-                }
-            } else {
-                // For directory blocks, scan the data_blocks array (used as hash table)
-                for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-                    uint32_t hash_block = endian::from_big_endian(block->data_blocks[i]);
-                    if (hash_block != 0) {
-                        scan_used_blocks(hash_block);
-                    }
-                }
-            }
-        }
-        
-        // Scan data blocks for files
-        if (sec_type == ST_FILE) {
-            uint32_t data_block = endian::from_big_endian(block->first_data);
-            while (data_block != 0) {
-                used_blocks_.insert(data_block);
-                free_blocks_.erase(data_block);
-                
-                const auto* data = get_block<DataBlock>(data_block);
-                if (!data) break;
-                data_block = endian::from_big_endian(data->next_data);
+                for (uint32_t hb : root->hash_table) pending.push_back(endian::from_big_endian(hb));
+            } else if (sec_type == ST_DIR) {
+                // Directories use data_blocks as their hash table
+                for (uint32_t hb : block->data_blocks) pending.push_back(endian::from_big_endian(hb));
             }
-        }
-        
-        // Scan chain
-        uint32_t next = endian::from_big_endian(block->hash_chain);
-        if (next != 0) {
-            scan_used_blocks(next);
+            if (block_num != root_block_num_) pending.push_back(endian::from_big_endian(block->hash_chain));
         }
     }
     
-    // requires fs_mutex_ held
-    uint32_t allocate_block() {
-        if (free_blocks_.empty()) return 0;
-        
-        uint32_t block = *free_blocks_.begin();
-        
-        // Precheck if bitmap update will succeed
-        uint32_t bitmap_index = block / 4064;
-        if (bitmap_index >= 25) return 0;  // Beyond supported range
-        
+    // Collects bitmap_pages_ from the root and its extension chain, marking the
+    // extension blocks used. Stops at the first empty slot or once the whole
+    // volume is covered; a chain longer than that is treated as corrupt.
+    void load_bitmap_pages() {
+        bitmap_pages_.clear();
+        bitmap_ext_blocks_.clear();
         const auto* root = get_block<RootBlock>(root_block_num_);
-        if (!root) return 0;
+        if (!root) return;
         
-        uint32_t bm_block = endian::from_big_endian(root->bm_pages[bitmap_index]);
-        if (bm_block == 0) {
-            // Disk full - no bitmap space for allocation (bitmap extension not implemented)
-            return 0;
+        size_t mapped = std::max<size_t>(file_size_ / BLOCK_SIZE, BM_FIRST) - BM_FIRST;
+        size_t needed = (mapped + BM_PAGE_BLOCKS - 1) / BM_PAGE_BLOCKS;
+        auto take = [&](const uint32_t* pages, size_t n) {
+            for (size_t i = 0; i < n && bitmap_pages_.size() < needed; i++) {
+                uint32_t bm_block = endian::from_big_endian(pages[i]);
+                if (bm_block == 0 || !get_block<BitmapBlock>(bm_block)) return false;
+                bitmap_pages_.push_back(bm_block);
+            }
+            return bitmap_pages_.size() < needed;
+        };
+        
+        if (!take(root->bm_pages, 25)) return;
+        uint32_t ext = endian::from_big_endian(root->bm_ext);
+        while (ext != 0 && free_map_.is_free(ext)) {
+            const auto* block = get_block<BitmapExtBlock>(ext);
+            if (!block) return;
+            free_map_.set_used(ext);
+            bitmap_ext_blocks_.push_back(ext);
+            if (!take(block->bm_pages, 127)) return;
+            ext = endian::from_big_endian(block->bm_ext);
         }
+    }
+    
+    std::shared_mutex& dir_lock(uint32_t dir_block) const {
+        return dir_locks_[dir_block % LOCK_STRIPES];
+    }
+    
+    std::shared_mutex& header_lock(uint32_t header_block) const {
+        return header_locks_[header_block % LOCK_STRIPES];
+    }
+    
+    // True if the on-disk bitmap has a page covering block
+    bool bitmap_covers(uint32_t block) const {
+        return block >= BM_FIRST && (block - BM_FIRST) / BM_PAGE_BLOCKS < bitmap_pages_.size();
+    }
+    
+    // requires fs_mutex_ held (shared is enough)
+    // Takes the first free block at or after goal, wrapping to the start of the
+    // disk. Like FFS, a goal of 0 means "near the root block", so headers and
+    // their data cluster in the middle of the disk instead of at the front.
+    uint32_t allocate_block(uint32_t goal = 0) {
+        std::lock_guard<std::mutex> lock(alloc_mutex_);
+        uint32_t block = free_map_.find_first_free(goal ? goal : root_block_num_);
+        if (block == 0 || !bitmap_covers(block)) block = free_map_.find_first_free();
+        if (block == 0 || !bitmap_covers(block)) return 0;
         
-        // Safe to proceed - bitmap update will work
-        free_blocks_.erase(block);
-        used_blocks_.insert(block);
-        
-        // Update bitmap (now guaranteed to succeed)
-        update_bitmap_for_block(block, false); // false = mark as used
+        free_map_.set_used(block);
+        mark_bitmap_dirty(block, 1);
+        if (!allocated_since_check_.empty()) allocated_since_check_[block] = true;
         
         // Clear the block
         void* data = get_block_writable<uint8_t>(block);
@@ -575,91 +1089,132 @@ public:
         return block;
     }
     
-    // requires fs_mutex_ held
+    // requires fs_mutex_ held (shared is enough)
+    // Bulk form of allocate_block: takes the free run starting at the first free
+    // block at or after goal, up to want blocks long. Blocks are NOT cleared; the caller
+    // initialises every one. Returns the run's start and its length in got, or
+    // 0 if the disk is full.
+    uint32_t allocate_extent(uint32_t goal, uint32_t want, uint32_t& got) {
+        got = 0;
+        std::lock_guard<std::mutex> lock(alloc_mutex_);
+        uint32_t start = free_map_.find_first_free(goal ? goal : root_block_num_);
+        if (start == 0 || !bitmap_covers(start)) start = free_map_.find_first_free();
+        if (start == 0 || !bitmap_covers(start)) return 0;
+        
+        // Stop short of any stretch the on-disk bitmap has no page for
+        uint64_t covered = BM_FIRST + uint64_t{bitmap_pages_.size()} * BM_PAGE_BLOCKS;
+        uint32_t end = static_cast<uint32_t>(std::min({uint64_t{free_map_.find_first_used(start)},
+                                                       uint64_t{start} + want, covered}));
+        
+        got = end - start;
+        free_map_.set_used_run(start, got);
+        mark_bitmap_dirty(start, got);
+        if (!allocated_since_check_.empty()) {
+            std::fill_n(allocated_since_check_.begin() + start, got, true);
+        }
+        return start;
+    }
+    
+    // requires fs_mutex_ held (shared is enough)
     void free_block(uint32_t block) {
         if (block < 2 || block == root_block_num_) return; // Don't free system blocks
         
-        used_blocks_.erase(block);
-        free_blocks_.insert(block);
-        
-        // Update bitmap
-        update_bitmap_for_block(block, true); // true = mark as free
+        std::lock_guard<std::mutex> lock(alloc_mutex_);
+        free_map_.set_free(block);
+        mark_bitmap_dirty(block, 1);
+    }
+    
+    // requires alloc_mutex_ held
+    // free_map_ is the allocator's source of truth; the on-disk bitmap blocks
+    // covering [first, first + count) are only flagged here and re-encoded from
+    // it by write_back_bitmap at the next commit
+    void mark_bitmap_dirty(uint32_t first, uint32_t count) {
+        uint64_t end = uint64_t{first} + count;
+        if (end <= BM_FIRST) return;
+        uint64_t last = (end - 1 - BM_FIRST) / BM_PAGE_BLOCKS;
+        uint64_t page = first > BM_FIRST ? (first - BM_FIRST) / BM_PAGE_BLOCKS : 0;
+        for (; page <= last && page < bitmap_dirty_.size(); page++) {
+            bitmap_dirty_[page] = true;
+        }
     }
     
-    void update_bitmap_for_block(uint32_t block, bool is_free) {
-        uint32_t total_blocks = static_cast<uint32_t>(file_size_ / BLOCK_SIZE);
-        if (block >= total_blocks || block < 2) return; // Guard free/boot blocks
-        
-        // Find which bitmap block this belongs to
-        uint32_t bitmap_index = block / 4064;
-        uint32_t bit_offset = block % 4064;
-        uint32_t word_index = bit_offset / 32;
-        uint32_t bit_index = bit_offset % 32;
-        
-        if (bitmap_index >= 25) return;
-        
-        const auto* root = get_block<RootBlock>(root_block_num_);
-        if (!root) return;
-        
-        uint32_t bm_block = endian::from_big_endian(root->bm_pages[bitmap_index]);
-        if (bm_block == 0) {
-            // Disk full - no more bitmap space (bitmap extension not implemented)
-            return; // Skip allocation - caller should handle lack of free blocks
-        }
+    // requires fs_mutex_ held exclusively
+    // Encodes every flagged bitmap block from free_map_ and re-checksums it.
+    // Bits past the end of the volume keep whatever the disk had.
+    void write_back_bitmap() {
+        std::lock_guard<std::mutex> lock(alloc_mutex_);
+        uint64_t total_blocks = file_size_ / BLOCK_SIZE;
         
-        auto* bitmap = get_block_writable<BitmapBlock>(bm_block);
-        if (!bitmap) return;
-        
-        uint32_t map_word = endian::from_big_endian(bitmap->map[word_index]);
-        if (is_free) {
-            map_word |= (1u << bit_index);  // Set bit = free
-        } else {
-            map_word &= ~(1u << bit_index); // Clear bit = used
+        for (size_t page = 0; page < bitmap_dirty_.size(); page++) {
+            if (!bitmap_dirty_[page]) continue;
+            bitmap_dirty_[page] = false;
+            
+            auto* bitmap = get_block_writable<BitmapBlock>(bitmap_pages_[page]);
+            if (!bitmap) continue;
+            
+            for (uint32_t j = 0; j < 127; j++) {
+                uint64_t first = BM_FIRST + page * BM_PAGE_BLOCKS + j * 32;
+                uint32_t hi = static_cast<uint32_t>(std::min<uint64_t>(32, total_blocks > first ? total_blocks - first : 0));
+                if (hi == 0) continue;
+                uint32_t valid = hi == 32 ? ~0u : (1u << hi) - 1;
+                
+                uint32_t old_word = endian::from_big_endian(bitmap->map[j]);
+                uint32_t map_word = free_map_.word32(static_cast<uint32_t>(first));  // Set bit = free
+                bitmap->map[j] = endian::to_big_endian((old_word & ~valid) | (map_word & valid));
+            }
+            update_bitmap_checksum(bitmap);
         }
-        bitmap->map[word_index] = endian::to_big_endian(map_word);
-        
-        // Update bitmap checksum
-        update_bitmap_checksum(bitmap);
     }
     
-    // ASCII-only uppercase for locale-independent Amiga hash
-    inline unsigned char ascii_upper(unsigned char c) {
-        return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+    // Canonical key for case-insensitive name matching
+    std::string fold_name(std::string_view name) const {
+        std::string folded(name.size(), '\0');
+        text::fold(folded.data(), name.data(), name.size(), intl_);
+        return folded;
     }
     
-    // Case-insensitive ASCII comparison for Amiga filename semantics
-    static bool equals_icase_ascii(std::string_view a, std::string_view b) {
-        if (a.size() != b.size()) return false;
-        for (size_t i = 0; i < a.size(); ++i) {
-            auto A = (a[i] >= 'a' && a[i] <= 'z') ? a[i] - 'a' + 'A' : a[i];
-            auto B = (b[i] >= 'a' && b[i] <= 'z') ? b[i] - 'a' + 'A' : b[i];
-            if (A != B) return false;
-        }
-        return true;
-    }
-    
-    uint32_t hash_name(const std::string& name) {
-        // Canonical Amiga hash function: h = 0; for (c) h = h*13 + toupper(c);
-        uint32_t h = 0;
-        for (unsigned char c : name) {
-            h = h * 13 + ascii_upper(c);
+    // AmigaDOS hash table bucket of a name already folded with the volume's table
+    static uint32_t amiga_hash(std::string_view folded) {
+        uint32_t h = static_cast<uint32_t>(folded.size());
+        for (unsigned char c : folded) {
+            h = (h * 13 + c) & 0x7FF;
         }
         return h % HASH_TABLE_SIZE;
     }
     
     [[nodiscard]] std::optional<std::vector<Entry>> list_directory(const std::string& path) {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
         return list_directory_unsafe(path);
     }
     
+    [[nodiscard]] std::optional<std::vector<Entry>> list_directory_at(uint32_t dir_block) {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        return list_directory_at_unsafe(dir_block);
+    }
+    
     [[nodiscard]] std::optional<std::vector<Entry>> list_directory_unsafe(const std::string& path) {
-        if (auto cached = get_cached_dir(path)) {
-            return cached;
-        }
-        
         uint32_t dir_block = find_directory_block(path);
         if (dir_block == 0) return std::nullopt;
+        return list_directory_at_unsafe(dir_block);
+    }
+    
+    // Served from the index; never reads a block
+    [[nodiscard]] std::optional<std::vector<Entry>> list_directory_at_unsafe(uint32_t dir_block) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto dir = nodes_.find(dir_block);
+        if (dir == nodes_.end() || !dir->second.entry.is_directory) return std::nullopt;
         
+        std::vector<Entry> entries;
+        entries.reserve(dir->second.children.size());
+        for (uint32_t child : dir->second.children) {
+            auto it = nodes_.find(child);
+            if (it != nodes_.end()) entries.push_back(it->second.entry);
+        }
+        return entries;
+    }
+    
+    // Reads a directory's entries from the headers in its hash table
+    [[nodiscard]] std::optional<std::vector<Entry>> scan_hash_table(uint32_t dir_block) {
         std::vector<Entry> entries;
         std::set<uint32_t> seen_blocks; // Prevent duplicate entries
         const auto* dir = get_block<FileBlock>(dir_block);
@@ -684,79 +1239,117 @@ public:
                 const auto* block = get_block<FileBlock>(block_num);
                 if (!block) break;
                 
-                Entry entry;
-                entry.name = BcplString::read(block->filename);
-                if (entry.name.empty()) {
-                    block_num = endian::from_big_endian(block->hash_chain);
-                    continue;
+                {
+                    std::shared_lock<std::shared_mutex> header(header_lock(block_num));
+                    Entry entry = entry_from_header(block_num, block);
+                    if (!entry.name.empty()) {
+                        entries.push_back(entry);
+                    }
                 }
                 
-                int32_t sec_type = endian::from_big_endian(block->sec_type);
-                entry.is_directory = (sec_type == ST_DIR);
-                entry.size = entry.is_directory ? 0 : endian::from_big_endian(block->file_size);
-                entry.block_num = block_num;
-                
-                uint32_t days = endian::from_big_endian(block->days);
-                uint32_t mins = endian::from_big_endian(block->mins);
-                uint32_t ticks = endian::from_big_endian(block->ticks);
-                entry.mtime = amiga_to_unix_time(days, mins, ticks);
-                
-                entries.push_back(entry);
-                
+                // hash_chain only changes under this directory's lock
                 block_num = endian::from_big_endian(block->hash_chain);
             }
         }
-        
-        cache_directory(path, entries);
         return entries;
     }
     
+    // The public lookups return everything a stat needs, subdirs included,
+    // from one pass under the lock
     [[nodiscard]] std::optional<Entry> get_entry(const std::string& path) {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
         return get_entry_unsafe(path);
     }
     
-    [[nodiscard]] std::optional<Entry> get_entry_unsafe(const std::string& path) {
-        if (path == "/" || path.empty()) {
-            Entry root;
-            root.name = "";
-            root.is_directory = true;
-            root.size = 0;
-            
-            // Report real root directory mtime from disk instead of time(nullptr)
-            auto* root_block = get_block<RootBlock>(root_block_num_);
-            if (root_block) {
-                uint32_t days = endian::from_big_endian(root_block->days);
-                uint32_t mins = endian::from_big_endian(root_block->mins);
-                uint32_t ticks = endian::from_big_endian(root_block->ticks);
-                root.mtime = amiga_to_unix_time(days, mins, ticks);
-            } else {
-                root.mtime = time(nullptr);
-            }
-            
-            root.block_num = root_block_num_;
-            return root;
-        }
+    // Attributes of a header by block number, without resolving a path.
+    // An unlinked file stays stat-able while it is open.
+    [[nodiscard]] std::optional<Entry> get_entry_at(uint32_t block_num) {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        if (auto entry = get_entry_at_unsafe(block_num)) return entry;
         
-        size_t last_slash = path.find_last_of('/');
-        std::string parent_path = (last_slash == 0) ? "/" : path.substr(0, last_slash);
-        std::string entry_name = path.substr(last_slash + 1);
-        
-        auto entries = list_directory_unsafe(parent_path);
-        if (!entries) return std::nullopt;
-        
-        for (const auto& entry : *entries) {
-            if (equals_icase_ascii(entry.name, entry_name)) {
-                return entry;
-            }
+        std::shared_lock<std::shared_mutex> header(header_lock(block_num));
+        if (live_file_locked(block_num) != 0) return std::nullopt;
+        const auto* block = get_block<FileBlock>(block_num);
+        if (!block) return std::nullopt;
+        return entry_from_header(block_num, block);
+    }
+    
+    // Counts an open handle on a file header, so that unlinking it keeps its
+    // blocks until the matching release_file
+    int open_file(uint32_t block_num) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto it = nodes_.find(block_num);
+        if (it == nodes_.end()) return -ENOENT;
+        if (it->second.entry.is_directory) return -EISDIR;
+        open_files_[block_num]++;
+        return 0;
+    }
+    
+    void release_file(uint32_t block_num) {
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            auto it = open_files_.find(block_num);
+            if (it == open_files_.end() || --it->second > 0) return;
+            open_files_.erase(it);
+            if (orphans_.erase(block_num) == 0) return;
         }
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        std::lock_guard<std::shared_mutex> header(header_lock(block_num));
+        free_file_locked(block_num);
+    }
+    
+    // Distinguishes successive headers that reuse one block number
+    uint64_t generation(uint32_t block_num) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto it = generations_.find(block_num);
+        return (it != generations_.end()) ? it->second : 0;
+    }
+    
+    [[nodiscard]] std::optional<Entry> lookup_at(uint32_t parent_block, const std::string& name) {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        return lookup_unsafe(parent_block, name);
+    }
+    
+    [[nodiscard]] std::optional<Entry> get_entry_unsafe(const std::string& path) {
+        uint32_t block = resolve_path(path);
+        if (block == 0) return std::nullopt;
+        return get_entry_at_unsafe(block);
+    }
+    
+    // Only live headers are indexed, so a stale inode finds nothing
+    [[nodiscard]] std::optional<Entry> get_entry_at_unsafe(uint32_t block_num) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto it = nodes_.find(block_num);
+        if (it == nodes_.end()) return std::nullopt;
+        return it->second.entry;
+    }
+    
+    [[nodiscard]] std::optional<Entry> lookup_unsafe(uint32_t parent_block, const std::string& name) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto it = nodes_.find(child_block_locked(parent_block, name));
+        if (it == nodes_.end()) return std::nullopt;
+        return it->second.entry;
+    }
+    
+    // requires cache_mutex_ held.
+    // Resolves one name to its header block, or 0, with a single hash lookup
+    uint32_t child_block_locked(uint32_t parent_block, std::string_view name) {
+        // Nothing longer can have been stored
+        if (name.size() > BCPL_STRING_MAX) return 0;
+        char folded[BCPL_STRING_MAX];
+        text::fold(folded, name.data(), name.size(), intl_);
         
-        return std::nullopt;
+        auto dir = dentries_.find(parent_block);
+        if (dir == dentries_.end()) return 0;
+        auto it = dir->second.find(std::string_view(folded, name.size()));
+        return (it != dir->second.end()) ? it->second : 0;
     }
     
     std::vector<uint8_t> read_file(uint32_t file_block_num, size_t offset, size_t size) {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
         if (!file_block_num) return {};
+        std::shared_lock<std::shared_mutex> header(header_lock(file_block_num));
+        if (live_file_locked(file_block_num) != 0) return {};
 
         const auto* file_block = get_block<FileBlock>(file_block_num);
         if (!file_block) return {};
@@ -767,226 +1360,117 @@ public:
         size = std::min<size_t>(size, fsize - offset);
 
         std::vector<uint8_t> out(size);
-        uint32_t first = endian::from_big_endian(file_block->first_data);
-
-        size_t want_idx = offset / 488;
-        size_t pos_in_block = offset % 488;
-
-        uint32_t cur = first;
-        size_t cur_idx = 0;
-
-        // seek to starting logical block
-        while (cur && cur_idx < want_idx) {
-            const auto* db = get_block<DataBlock>(cur);
-            if (!db) { cur = 0; break; }
-            
-            // Defensive check against corruption
-            if (endian::from_big_endian(db->type) != static_cast<uint32_t>(T_DATA) ||
-                endian::from_big_endian(db->header_key) != file_block_num) {
-                cur = 0; break; // Stop on corruption
-            }
-            
-            cur = endian::from_big_endian(db->next_data);
-            ++cur_idx;
-        }
-
         size_t produced = 0;
-        while (produced < size) {
-            if (!cur) {
-                // hole: zero-fill until end of this logical block
-                size_t can = std::min<size_t>(size - produced, 488 - pos_in_block);
-                std::memset(out.data() + produced, 0, can);
-                produced += can;
-                pos_in_block += can;
-                if (pos_in_block >= 488) { pos_in_block = 0; ++cur_idx; }
-                continue;
-            }
-
-            const auto* db = get_block<DataBlock>(cur);
-            if (!db) break;
-            
-            // Defensive check against corruption
-            if (endian::from_big_endian(db->type) != static_cast<uint32_t>(T_DATA) ||
-                endian::from_big_endian(db->header_key) != file_block_num) {
-                break; // Stop on corruption
+        for_each_payload(file_block_num, offset, size, [&](const uint8_t* src, size_t len) {
+            if (src) {
+                std::memcpy(out.data() + produced, src, len);
+            } else {
+                std::memset(out.data() + produced, 0, len);
             }
+            produced += len;
+        });
 
-            uint32_t db_size = std::min<uint32_t>(488u, endian::from_big_endian(db->data_size));
-            size_t need = std::min<size_t>(size - produced, 488 - pos_in_block);
+        return out;
+    }
+    
+    // Zero-copy read: describes the range as buffers pointing into the mmap
+    // and hands them to reply. The spans are only valid while the header lock
+    // is held, since a truncate may free the blocks and another file may reuse
+    // them, so reply must have copied the data out by the time it returns.
+    template <typename Reply>
+    int reply_file_bufvec(uint32_t file_block_num, size_t offset, size_t size, Reply&& reply) {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        if (!file_block_num) return -ENOENT;
+        std::shared_lock<std::shared_mutex> header(header_lock(file_block_num));
+        int live = live_file_locked(file_block_num);
+        if (live != 0) return live;
 
-            if (pos_in_block < db_size) {
-                size_t take = std::min<size_t>(need, db_size - pos_in_block);
-                std::memcpy(out.data() + produced, db->data + pos_in_block, take);
-                produced += take;
-                pos_in_block += take;
-                need -= take;
-            }
-            if (need) { // inside logical block but past data_size => zeros
-                std::memset(out.data() + produced, 0, need);
-                produced += need;
-                pos_in_block += need;
-            }
+        const auto* file_block = get_block<FileBlock>(file_block_num);
+        if (!file_block) return -EIO;
 
-            if (pos_in_block >= 488) {
-                pos_in_block = 0;
-                cur = endian::from_big_endian(db->next_data);
-                ++cur_idx;
-            }
+        uint32_t fsize = endian::from_big_endian(file_block->file_size);
+        size = (offset >= fsize) ? 0 : std::min<size_t>(size, fsize - offset);
+
+        // At most a payload span and a zero tail per logical block. The
+        // vector lives in per-thread storage that only ever grows, so a read
+        // allocates nothing once its thread has served one as large
+        size_t max_bufs = size ? 2 * ((offset % 488 + size + 487) / 488) : 1;
+        size_t bytes = sizeof(fuse_bufvec) + (max_bufs - 1) * sizeof(fuse_buf);
+        thread_local std::vector<std::max_align_t> storage;
+        if (storage.size() * sizeof(std::max_align_t) < bytes) {
+            storage.resize((bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t));
         }
-
-        return out;
+        auto* vec = reinterpret_cast<fuse_bufvec*>(storage.data());
+
+        vec->count = 0;
+        vec->idx = 0;
+        vec->off = 0;
+        vec->buf[0] = fuse_buf{};
+        
+        for_each_payload(file_block_num, offset, size, [&](const uint8_t* src, size_t len) {
+            fuse_buf& b = vec->buf[vec->count++];
+            b = fuse_buf{};
+            b.size = len;
+            b.mem = const_cast<uint8_t*>(src ? src : ZERO_PAYLOAD.data());
+            b.fd = -1;
+        });
+        if (vec->count == 0) vec->count = 1; // empty read: one zero-length buffer
+
+        reply(vec);
+        return 0;
     }
     
     int write_file(uint32_t file_block_num, const void* buf, size_t size, size_t offset) {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
         if (read_only_) return -EROFS;
         if (file_block_num == 0) return -ENOENT;
+        std::lock_guard<std::shared_mutex> header(header_lock(file_block_num));
+        
+        // The inode may outlive the file, and its block may since be another header
+        int live = live_file_locked(file_block_num);
+        if (live != 0) return live;
         
         // Guard against 32-bit overflow
         if (add_would_overflow_u32(offset, size)) return -EFBIG;
+        if (size == 0) return 0;
         
         auto* file_block = get_block_writable<FileBlock>(file_block_num);
         if (!file_block) return -EIO;
         
-        uint32_t current_size = endian::from_big_endian(file_block->file_size);
-        uint32_t new_size = std::max(current_size, static_cast<uint32_t>(offset + size));
+        auto& index = get_block_index(file_block_num);
         
-        // Update file size if needed
-        if (new_size != current_size) {
-            file_block->file_size = endian::to_big_endian(new_size);
-            update_checksum(file_block);
-        }
+        // Refuse to relink a chain we could not fully follow
+        if (index.corrupt) return -EIO;
         
-        // Write to data blocks
-        uint32_t first_data_block = endian::from_big_endian(file_block->first_data);
-        if (first_data_block == 0 && size > 0) {
-            // Need to allocate first data block
-            first_data_block = allocate_block();
-            if (first_data_block == 0) return -ENOSPC;
-            
-            file_block->first_data = endian::to_big_endian(first_data_block);
-            update_checksum(file_block);
-            
-            // Initialize data block
-            auto* data_block = get_block_writable<DataBlock>(first_data_block);
-            if (data_block) {
-                data_block->type = endian::to_big_endian(static_cast<uint32_t>(T_DATA));
-                data_block->header_key = endian::to_big_endian(file_block_num);
-                data_block->seq_num = endian::to_big_endian(1u);
-                data_block->next_data = 0;
-            }
+        // Extend the chain up to the last logical block touched by this write,
+        // bridging any gap past EOF with zero-filled blocks
+        size_t first_idx = offset / 488;
+        size_t last_idx = (offset + size - 1) / 488;
+        if (index.blocks.size() <= last_idx) {
+            // Blocks this write fills completely need no zeroing first
+            grow_chain(file_block_num, file_block, index, last_idx + 1,
+                       (offset + 487) / 488, (offset + size) / 488);
         }
+        if (index.blocks.size() <= first_idx) return -ENOSPC;
         
-        // Navigate to target offset with proper sparse write handling
-        size_t target_offset = offset;
+        // Now write data starting at offset
         const uint8_t* data = static_cast<const uint8_t*>(buf);
-        
-        // Walk existing chain to find insertion point
-        uint32_t current_block = first_data_block;
-        uint32_t prev_block = 0;
-        size_t current_pos = 0;
-        
-        while (current_block != 0) {
-            const auto* data_block = get_block<DataBlock>(current_block);
-            if (!data_block) return -EIO;
-            
-            // Defensive check against corruption
-            if (endian::from_big_endian(data_block->type) != static_cast<uint32_t>(T_DATA) ||
-                endian::from_big_endian(data_block->header_key) != file_block_num) {
-                return -EIO; // Stop on corruption
-            }
-            
-            // If target offset is within this block range, break
-            if (current_pos + 488 > target_offset) break;
-            
-            // Always advance by 488 for offset addressing (not actual data_size)
-            current_pos += 488;
-            prev_block = current_block;
-            current_block = endian::from_big_endian(data_block->next_data);
-        }
-        
-        // Create zero-filled blocks to bridge any gaps
-        while (current_pos + 488 <= target_offset) {
-            uint32_t new_block = allocate_block();
-            if (new_block == 0) return -ENOSPC;
-            
-            auto* new_data = get_block_writable<DataBlock>(new_block);
-            if (!new_data) return -EIO;
-            
-            new_data->type = endian::to_big_endian(static_cast<uint32_t>(T_DATA));
-            new_data->header_key = endian::to_big_endian(file_block_num);
-            new_data->seq_num = endian::to_big_endian(static_cast<uint32_t>(current_pos / 488 + 1));
-            new_data->data_size = 0;
-            new_data->next_data = 0;
-            std::memset(new_data->data, 0, 488);
-            
-            // Link into chain
-            if (prev_block != 0) {
-                auto* prev_data = get_block_writable<DataBlock>(prev_block);
-                if (prev_data) {
-                    prev_data->next_data = endian::to_big_endian(new_block);
-                    update_checksum(prev_data);
-                }
-            } else {
-                file_block->first_data = endian::to_big_endian(new_block);
-                update_checksum(file_block);
-            }
-            
-            update_checksum(new_data);
-            prev_block = new_block;
-            current_block = new_block;
-            current_pos += 488;
-        }
-        
-        // Now write data starting at target_offset
         size_t bytes_written = 0;
-        size_t write_pos = target_offset;
+        size_t block_offset = offset % 488;
         
-        while (bytes_written < size) {
-            // Allocate new block if needed
-            if (current_block == 0) {
-                current_block = allocate_block();
-                if (current_block == 0) return bytes_written;
-                
-                auto* new_data = get_block_writable<DataBlock>(current_block);
-                if (!new_data) return -EIO;
-                
-                new_data->type = endian::to_big_endian(static_cast<uint32_t>(T_DATA));
-                new_data->header_key = endian::to_big_endian(file_block_num);
-                new_data->seq_num = endian::to_big_endian(static_cast<uint32_t>(current_pos / 488 + 1));
-                new_data->data_size = 0;
-                new_data->next_data = 0;
-                std::memset(new_data->data, 0, 488);
-                
-                if (prev_block != 0) {
-                    auto* prev_data = get_block_writable<DataBlock>(prev_block);
-                    if (prev_data) {
-                        prev_data->next_data = endian::to_big_endian(current_block);
-                        update_checksum(prev_data);
-                    }
-                } else {
-                    file_block->first_data = endian::to_big_endian(current_block);
-                    update_checksum(file_block);
-                }
-                
-                update_checksum(new_data);
-            }
-            
-            auto* data_block = get_block_writable<DataBlock>(current_block);
+        for (size_t idx = first_idx; idx <= last_idx && idx < index.blocks.size(); ++idx) {
+            auto* data_block = get_block_writable<DataBlock>(index.blocks[idx]);
             if (!data_block) return -EIO;
             
-            // Calculate position within current block
-            size_t block_start = (current_pos / 488) * 488;
-            size_t block_offset = write_pos - block_start;
             size_t write_size = std::min(size - bytes_written, 488 - block_offset);
-            
-            if (block_offset >= 488) return -EIO;  // Safety check
-            
-            // Write data
             std::memcpy(data_block->data + block_offset, data + bytes_written, write_size);
             
-            // Update block data size with clamping
+            // Update block data size with clamping; a gap after the old end
+            // may hold bytes a truncate cut off, so it reads back as zeros
             uint32_t old_size = endian::from_big_endian(data_block->data_size);
+            if (old_size < block_offset) {
+                std::memset(data_block->data + old_size, 0, block_offset - old_size);
+            }
             uint32_t new_size = std::max(old_size, static_cast<uint32_t>(block_offset + write_size));
             if (new_size > 488u) new_size = 488u; // Clamp to block data limit
             data_block->data_size = endian::to_big_endian(new_size);
@@ -994,123 +1478,723 @@ public:
             update_checksum(data_block);
             
             bytes_written += write_size;
-            write_pos += write_size;
-            
-            // Move to next block if this one is full
-            if (block_offset + write_size >= 488) {
-                prev_block = current_block;
-                current_block = endian::from_big_endian(data_block->next_data);
-                current_pos = ((current_pos / 488) + 1) * 488;
-            }
+            block_offset = 0;
         }
         
+        // Grow file size to cover what actually landed on disk
+        uint32_t current_size = endian::from_big_endian(file_block->file_size);
+        uint32_t new_size = std::max(current_size, static_cast<uint32_t>(offset + bytes_written));
+        set_checksummed(file_block, file_block->file_size, new_size);
+        
         // Update high_seq to reflect last data block sequence index
-        uint32_t blocks = (endian::from_big_endian(file_block->file_size) + 487) / 488;
-        file_block->high_seq = endian::to_big_endian(blocks ? (blocks - 1) : 0u);
+        uint32_t blocks = (new_size + 487) / 488;
+        set_checksummed(file_block, file_block->high_seq, blocks ? (blocks - 1) : 0u);
         
         // Update file timestamps after successful write
         touch_fileblock(file_block);
-        update_checksum(file_block);
+        refresh_node_locked(file_block_num);
         
         return bytes_written;
     }
     
     int create_file(const std::string& path, mode_t) {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
         if (read_only_) return -EROFS;
         
-        size_t last_slash = path.find_last_of('/');
-        std::string parent_path = (last_slash == 0) ? "/" : path.substr(0, last_slash);
-        std::string filename = path.substr(last_slash + 1);
-        
-        if (filename.length() > BCPL_STRING_MAX) return -ENAMETOOLONG;
+        auto [parent_path, filename] = split_path(path);
+        uint32_t parent_block = find_directory_block(parent_path);
+        if (parent_block == 0) return -ENOENT;
         
-        // Check if file already exists (case-insensitive for Amiga semantics)
-        if (auto ents = list_directory_unsafe(parent_path)) {
-            for (const auto& e : *ents) {
-                if (equals_icase_ascii(e.name, filename)) return -EEXIST;
+        uint32_t file_block = 0;
+        return create_entry_unsafe(parent_block, filename, ST_FILE, file_block);
+    }
+    
+    int create_file_at(uint32_t parent_block, const std::string& filename, uint32_t& file_block) {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        if (read_only_) return -EROFS;
+        return create_entry_unsafe(parent_block, filename, ST_FILE, file_block);
+    }
+    
+    int delete_file(const std::string& path) {
+        int r;
+        {
+            std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+            if (read_only_) {
+                DBG(std::cerr << "DEBUG: delete_file failed - filesystem is read-only" << std::endl);
+                return -EROFS;
+            }
+            
+            auto [parent_path, filename] = split_path(path);
+            uint32_t parent_block = find_directory_block(parent_path);
+            if (parent_block == 0) {
+                DBG(std::cerr << "DEBUG: delete_file failed - file not found: " << path << std::endl);
+                return -ENOENT;
             }
+            
+            r = delete_file_unsafe(parent_block, filename);
+        }
+        // Syncing needs fs_mutex_ exclusively
+        if (r == 0) sync_after_op();
+        return r;
+    }
+    
+    int delete_file_at(uint32_t parent_block, const std::string& filename) {
+        int r;
+        {
+            std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+            if (read_only_) return -EROFS;
+            r = delete_file_unsafe(parent_block, filename);
         }
+        if (r == 0) sync_after_op();
+        return r;
+    }
+    
+    int truncate_file(const std::string& path, off_t size) {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        if (read_only_) return -EROFS;
+        
+        auto entry = get_entry_unsafe(path);
+        if (!entry) return -ENOENT;
+        if (entry->is_directory) return -EISDIR;
         
-        // Find parent directory block
+        std::lock_guard<std::shared_mutex> header(header_lock(entry->block_num));
+        return truncate_file_unsafe(entry->block_num, size);
+    }
+    
+    int truncate_file_at(uint32_t file_block_num, off_t size) {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        if (read_only_) return -EROFS;
+        
+        std::lock_guard<std::shared_mutex> header(header_lock(file_block_num));
+        int live = live_file_locked(file_block_num);
+        if (live != 0) return live;
+        return truncate_file_unsafe(file_block_num, size);
+    }
+    
+    // Preallocates the data chain for [0, offset + length) in contiguous runs so
+    // later writes only fill payloads. Unless keep_size is set, the file grows
+    // to cover the range and reads back zeros there.
+    int allocate_file_at(uint32_t file_block_num, size_t offset, size_t length, bool keep_size) {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        if (read_only_) return -EROFS;
+        if (add_would_overflow_u32(offset, length)) return -EFBIG;
+        
+        std::lock_guard<std::shared_mutex> header(header_lock(file_block_num));
+        int live = live_file_locked(file_block_num);
+        if (live != 0) return live;
+        return allocate_file_unsafe(file_block_num, offset + length, keep_size);
+    }
+    
+    int create_directory(const std::string& path, mode_t) {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        if (read_only_) return -EROFS;
+        
+        auto [parent_path, dirname] = split_path(path);
         uint32_t parent_block = find_directory_block(parent_path);
         if (parent_block == 0) return -ENOENT;
         
-        // Allocate new file block
-        uint32_t file_block = allocate_block();
-        if (file_block == 0) return -ENOSPC;
+        uint32_t dir_block = 0;
+        return create_entry_unsafe(parent_block, dirname, ST_DIR, dir_block);
+    }
+    
+    int create_directory_at(uint32_t parent_block, const std::string& dirname, uint32_t& dir_block) {
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        if (read_only_) return -EROFS;
+        return create_entry_unsafe(parent_block, dirname, ST_DIR, dir_block);
+    }
+    
+    int delete_directory(const std::string& path) {
+        std::lock_guard<std::shared_mutex> lock(fs_mutex_);
+        if (read_only_) return -EROFS;
+        if (path == "/" || path.empty()) return -EINVAL;
+        
+        auto [parent_path, dirname] = split_path(path);
+        uint32_t parent_block = find_directory_block(parent_path);
+        if (parent_block == 0) return -ENOENT;
+        
+        return delete_directory_unsafe(parent_block, dirname);
+    }
+    
+    int delete_directory_at(uint32_t parent_block, const std::string& dirname) {
+        std::lock_guard<std::shared_mutex> lock(fs_mutex_);
+        if (read_only_) return -EROFS;
+        return delete_directory_unsafe(parent_block, dirname);
+    }
+    
+    const std::string& volume_name() const { return volume_name_; }
+    uint32_t root_block() const { return root_block_num_; }
+    bool is_ffs() const { return is_ffs_; }
+    bool has_dircache() const { return dircache_; }
+    
+    void sync_to_disk() {
+        std::lock_guard<std::shared_mutex> lock(fs_mutex_);
+        sync_to_disk_unsafe();
+    }
+    
+    // requires fs_mutex_ held exclusively
+    void sync_to_disk_unsafe() {
+        if (mapped_data_ && !read_only_) {
+            // Also ensure kernel writes complete, unless nothing changed
+            if (flush_dirty_pages()) {
+                fsync(fd_);
+            }
+        }
+    }
+    
+    void set_durability(Durability mode, unsigned commit_ms) {
+        durability_ = mode;
+        commit_ms_ = commit_ms ? commit_ms : 1;
+    }
+    
+    Durability durability() const { return durability_; }
+    
+    // Commit point after a mutating operation or close; only strict mode syncs here
+    void sync_after_op() {
+        if (durability_ == Durability::Strict) sync_to_disk();
+    }
+    
+    // requires fs_mutex_ held exclusively
+    void sync_after_op_unsafe() {
+        if (durability_ == Durability::Strict) sync_to_disk_unsafe();
+    }
+    
+    // Commit point for an explicit fsync; ignored only in unmount mode
+    void sync_on_fsync() {
+        if (durability_ != Durability::Unmount) sync_to_disk();
+    }
+    
+    // Starts the background committer for periodic mode. Must run after
+    // fuse_main has daemonized, since threads do not survive the fork.
+    void start_periodic_commit() {
+        if (durability_ != Durability::Periodic || read_only_ || commit_thread_.joinable()) return;
+        
+        commit_stop_ = false;
+        commit_thread_ = std::thread([this] {
+            std::unique_lock<std::shared_mutex> lock(fs_mutex_);
+            while (!commit_cv_.wait_for(lock, std::chrono::milliseconds(commit_ms_),
+                                        [this] { return commit_stop_; })) {
+                sync_to_disk_unsafe();
+            }
+        });
+    }
+    
+    void stop_periodic_commit() {
+        {
+            std::lock_guard<std::shared_mutex> lock(fs_mutex_);
+            commit_stop_ = true;
+        }
+        commit_cv_.notify_all();
+        if (commit_thread_.joinable()) commit_thread_.join();
+    }
+    
+    // Starts the background check of the bitmap against the directory tree.
+    // Like the committer it must start after fuse_main has daemonized. Only a
+    // trusted bitmap needs it; otherwise the mount already walked the tree.
+    void start_background_check() {
+        if (check_thread_.joinable() || !is_valid() || !bitmap_trusted_) return;
+        {
+            std::lock_guard<std::shared_mutex> lock(fs_mutex_);
+            check_stop_ = false;
+            std::lock_guard<std::mutex> alloc(alloc_mutex_);
+            if (check_stats_.done) return;
+        }
+        check_thread_ = std::thread([this] { run_background_check(); });
+    }
+    
+    void stop_background_check() {
+        {
+            std::lock_guard<std::shared_mutex> lock(fs_mutex_);
+            check_stop_ = true;
+        }
+        if (!check_thread_.joinable()) return;
+        check_thread_.join();
+        if (!consistency_stats().done) {
+            report(LOG_INFO, "bitmap check did not finish before unmount; the bitmap stays flagged not valid");
+        }
+    }
+    
+    bool bitmap_trusted() const { return bitmap_trusted_; }
+    
+    ConsistencyStats consistency_stats() const {
+        std::lock_guard<std::mutex> alloc(alloc_mutex_);
+        return check_stats_;
+    }
+    
+private:
+    // requires fs_mutex_ held exclusively, or no other thread running yet
+    void set_bitmap_flag(uint32_t flag) {
+        const auto* current = get_block<RootBlock>(root_block_num_);
+        if (!current || endian::from_big_endian(current->bm_flag) == flag) return;
+        auto* root = get_block_writable<RootBlock>(root_block_num_);
+        if (root) set_checksummed(root, root->bm_flag, flag);
+    }
+    
+    // Writes one block's page out now, outside the usual commit points
+    void msync_block(uint32_t block_num) {
+        static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t byte = static_cast<size_t>(block_num) * BLOCK_SIZE;
+        size_t start = byte - byte % page_size;
+        msync(static_cast<uint8_t*>(mapped_data_) + start,
+              std::min(page_size, file_size_ - start), MS_SYNC);
+    }
+    
+    // requires fs_mutex_ held (shared is enough) and header_lock(header) held.
+    // Every block a header owns: itself, a file's data blocks whether listed
+    // in FFS block tables (header and T_LIST extensions) or chained OFS style,
+    // and a directory's dircache chain.
+    // If unconfirmed is given, it collects what header points at without
+    // proof the block is still its own: FFS table entries, which carry no
+    // back-pointer, and the block where a chain stops on a failed check.
+    std::vector<uint32_t> owned_blocks(uint32_t header, std::vector<uint32_t>* unconfirmed = nullptr) {
+        std::vector<uint32_t> owned{header};
+        const auto* fb = get_block<FileBlock>(header);
+        if (!fb) return owned;
+        
+        // Each loop is bounded by the disk size so a looped chain cannot spin forever
+        size_t limit = total_blocks();
+        if (endian::from_big_endian(fb->sec_type) == ST_FILE) {
+            const FileBlock* table = fb;
+            for (size_t n = 0; table && n < limit; n++) {
+                for (uint32_t b : table->data_blocks) {
+                    if (!b) continue;
+                    owned.push_back(endian::from_big_endian(b));
+                    if (unconfirmed) unconfirmed->push_back(endian::from_big_endian(b));
+                }
+                uint32_t ext = endian::from_big_endian(table->extension);
+                table = ext ? get_block<FileBlock>(ext) : nullptr;
+                if (!table || endian::from_big_endian(table->type) != static_cast<uint32_t>(T_LIST)) break;
+                owned.push_back(ext);
+            }
+            
+            uint32_t cur = endian::from_big_endian(fb->first_data);
+            for (size_t n = 0; cur != 0 && n < limit; n++) {
+                const auto* db = get_block<DataBlock>(cur);
+                if (!db || endian::from_big_endian(db->type) != static_cast<uint32_t>(T_DATA) ||
+                    endian::from_big_endian(db->header_key) != header) {
+                    if (unconfirmed) unconfirmed->push_back(cur);
+                    break;
+                }
+                owned.push_back(cur);
+                cur = endian::from_big_endian(db->next_data);
+            }
+        } else if (dircache_) {
+            std::lock_guard<std::mutex> dc_lock(dircache_mutex_);
+            uint32_t dc_block = endian::from_big_endian(fb->extension);
+            for (size_t n = 0; dc_block != 0 && n < limit; n++) {
+                const auto* dc = get_block<DirCacheBlock>(dc_block);
+                if (!dc || endian::from_big_endian(dc->type) != static_cast<uint32_t>(T_DIRCACHE)) {
+                    if (unconfirmed) unconfirmed->push_back(dc_block);
+                    break;
+                }
+                owned.push_back(dc_block);
+                dc_block = endian::from_big_endian(dc->next_dirc);
+            }
+        }
+        return owned;
+    }
+    
+    // Body of the check thread. Walks every header indexed at mount, one at a
+    // time under its header lock so it cannot be freed underneath us, and
+    // marks used any block it owns that the bitmap has free. A block the
+    // header claims that was handed out since mount was free in the bitmap
+    // and now has a second owner; such cross-links are counted and logged.
+    // Then counts blocks the bitmap has in use that nothing owns; those
+    // are only logged.
+    void run_background_check() {
+        std::vector<uint32_t> headers;
+        {
+            std::lock_guard<std::mutex> cache(cache_mutex_);
+            headers.reserve(nodes_.size());
+            for (const auto& [block, node] : nodes_) headers.push_back(block);
+        }
+        
+        ConsistencyStats stats;
+        std::vector<bool> reached(total_blocks(), false);
+        constexpr size_t LOG_LIMIT = 10;
+        
+        for (uint32_t header : headers) {
+            std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+            if (check_stop_) break;
+            std::shared_lock<std::shared_mutex> guard(header_lock(header));
+            {
+                std::lock_guard<std::mutex> cache(cache_mutex_);
+                // Deleted since, unless still open
+                if (nodes_.find(header) == nodes_.end() && orphans_.count(header) == 0) continue;
+            }
+            std::vector<uint32_t> unconfirmed;
+            auto owned = owned_blocks(header, &unconfirmed);
+            
+            std::lock_guard<std::mutex> alloc(alloc_mutex_);
+            stats.headers++;
+            // This tree never writes FFS tables, and a block it chained onto
+            // header carries header's key, so neither is one of these
+            for (uint32_t b : unconfirmed) {
+                if (b >= reached.size() || !allocated_since_check_[b]) continue;
+                if (stats.cross_linked++ < LOG_LIMIT) {
+                    report(LOG_WARNING, "WARNING: block " + std::to_string(b) + " of header " +
+                           std::to_string(header) + " was free in the bitmap and has been reused since mount");
+                }
+            }
+            for (uint32_t b : owned) {
+                if (b >= reached.size() || reached[b]) continue;
+                reached[b] = true;
+                stats.blocks++;
+                if (!free_map_.is_free(b)) continue;
+                
+                free_map_.set_used(b);
+                mark_bitmap_dirty(b, 1);
+                if (stats.marked_free++ < LOG_LIMIT) {
+                    report(LOG_WARNING, "WARNING: block " + std::to_string(b) + " belongs to header " +
+                           std::to_string(header) + " but was free in the bitmap; marked used");
+                }
+            }
+        }
+        
+        std::shared_lock<std::shared_mutex> lock(fs_mutex_);
+        std::lock_guard<std::mutex> alloc(alloc_mutex_);
+        if (!check_stop_) {
+            for (uint32_t b : {0u, 1u, root_block_num_}) reached[b] = true;
+            for (uint32_t b : bitmap_pages_) reached[b] = true;
+            for (uint32_t b : bitmap_ext_blocks_) reached[b] = true;
+            for (uint32_t b = 0; b < reached.size(); b++) {
+                if (!reached[b] && !free_map_.is_free(b) && !allocated_since_check_[b]) {
+                    stats.unreachable++;
+                }
+            }
+            stats.done = true;
+            if (stats.marked_free || stats.unreachable || stats.cross_linked) {
+                report(LOG_WARNING, "WARNING: bitmap check of " + std::to_string(stats.headers) +
+                       " headers: " + std::to_string(stats.marked_free) +
+                       " blocks in use were marked free, " + std::to_string(stats.unreachable) +
+                       " marked used are owned by nothing, " + std::to_string(stats.cross_linked) +
+                       " reused since mount while still claimed");
+            } else {
+                syslog(LOG_INFO, "bitmap check of %zu headers and %zu blocks found no mismatch",
+                       stats.headers, stats.blocks);
+            }
+        }
+        check_stats_ = stats;
+        allocated_since_check_.clear();
+    }
+    
+    // requires fs_mutex_ held exclusively
+    // msyncs only the pages holding dirty blocks, coalescing adjacent pages
+    // into one call. Returns false if nothing was dirty.
+    bool flush_dirty_pages() {
+        write_back_bitmap();
+        if (dirty_blocks_.empty()) return false;
+        
+        static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        auto* base = static_cast<uint8_t*>(mapped_data_);
+        size_t run_start = 0;
+        size_t run_end = 0;
+        
+        for (uint32_t block : dirty_blocks_) {
+            size_t byte = static_cast<size_t>(block) * BLOCK_SIZE;
+            size_t start = byte - byte % page_size;
+            size_t end = std::min(start + page_size, file_size_);
+            if (run_end != 0 && start <= run_end) {
+                run_end = std::max(run_end, end);
+                continue;
+            }
+            if (run_end != 0) msync(base + run_start, run_end - run_start, MS_SYNC);
+            run_start = start;
+            run_end = end;
+        }
+        msync(base + run_start, run_end - run_start, MS_SYNC);
         
-        // Initialize file block
-        auto* file = get_block_writable<FileBlock>(file_block);
-        if (!file) {
-            free_block(file_block);
-            return -EIO;
+        dirty_blocks_.clear();
+        return true;
+    }
+    
+    // Loads the namespace index, one directory at a time from the root.
+    // Each listing comes from the dircache chain where there is one and
+    // from the headers in the hash table otherwise. A header reachable
+    // twice, through a cycle or cross-linked directories, is indexed at
+    // the first place it is found.
+    // This runs at every mount, trusted bitmap or not, so mount time still
+    // grows with the number of files; the bitmap only spares the data chains.
+    void build_index() {
+        Entry root = root_entry();
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            nodes_.clear();
+            dentries_.clear();
+            nodes_.emplace(root_block_num_, Node{0, std::move(root), {}, 0, {}});
         }
         
-        std::memset(file, 0, BLOCK_SIZE);
-        file->type = endian::to_big_endian(static_cast<uint32_t>(T_HEADER));
-        file->header_key = endian::to_big_endian(file_block);
-        file->parent = endian::to_big_endian(parent_block);
-        file->sec_type = endian::to_big_endian(ST_FILE);
-        file->file_size = 0;
-        file->first_data = 0;
+        std::vector<uint32_t> pending{root_block_num_};
+        while (!pending.empty()) {
+            uint32_t dir_block = pending.back();
+            pending.pop_back();
+            
+            auto entries = read_dircache(dir_block);
+            if (!entries) entries = scan_hash_table(dir_block);
+            if (!entries) continue;
+            
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            for (auto& entry : *entries) {
+                if (entry.block_num < 2 || entry.block_num >= total_blocks() ||
+                    nodes_.count(entry.block_num)) {
+                    continue;
+                }
+                if (entry.is_directory) pending.push_back(entry.block_num);
+                std::string folded = fold_name(entry.name);
+                uint32_t hash = amiga_hash(folded);
+                link_node_locked(dir_block, std::move(entry), std::move(folded), hash);
+            }
+        }
+    }
+    
+    // requires cache_mutex_ held.
+    // folded and hash are computed once per name, here or by the caller
+    void link_node_locked(uint32_t parent_block, Entry entry, std::string folded, uint32_t hash) {
+        auto parent = nodes_.find(parent_block);
+        if (parent == nodes_.end()) return;
+        parent->second.children.push_back(entry.block_num);
+        if (entry.is_directory) parent->second.entry.subdirs++;
         
-        // Set filename
-        BcplString::write(file->filename, filename);
+        dentries_[parent_block].try_emplace(folded, entry.block_num);
+        uint32_t block_num = entry.block_num;
+        nodes_.insert_or_assign(block_num,
+            Node{parent_block, std::move(entry), std::move(folded), hash, {}});
+    }
+    
+    // requires cache_mutex_ held
+    void unlink_node_locked(uint32_t block_num) {
+        auto node = nodes_.find(block_num);
+        if (node == nodes_.end()) return;
         
-        // Set timestamps
-        auto [days, mins, ticks] = unix_to_amiga_time(time(nullptr));
-        file->days = endian::to_big_endian(days);
-        file->mins = endian::to_big_endian(mins);
-        file->ticks = endian::to_big_endian(ticks);
+        uint32_t parent_block = node->second.parent;
+        auto parent = nodes_.find(parent_block);
+        if (parent != nodes_.end()) {
+            std::erase(parent->second.children, block_num);
+            if (node->second.entry.is_directory) parent->second.entry.subdirs--;
+        }
+        auto names = dentries_.find(parent_block);
+        if (names != dentries_.end()) {
+            auto it = names->second.find(node->second.folded);
+            if (it != names->second.end() && it->second == block_num) names->second.erase(it);
+        }
+        dentries_.erase(block_num);
+        nodes_.erase(node);
+    }
+    
+    // requires dir_lock(parent_block) held exclusively, or fs_mutex_ held exclusively.
+    // Indexes a header that has just been linked into parent_block
+    void index_node(uint32_t parent_block, uint32_t block_num, std::string folded, uint32_t hash) {
+        Entry entry = load_entry(block_num);
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        link_node_locked(parent_block, std::move(entry), std::move(folded), hash);
+    }
+    
+    // requires dir_lock of the header's parent held exclusively, or fs_mutex_
+    // held exclusively.
+    // Returns the bucket the header was filed under, or HASH_TABLE_SIZE if unknown
+    uint32_t unindex_node(uint32_t block_num) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto node = nodes_.find(block_num);
+        uint32_t hash = (node != nodes_.end()) ? node->second.hash : HASH_TABLE_SIZE;
+        unlink_node_locked(block_num);
+        return hash;
+    }
+    
+    // requires header_lock(block_num) held
+    // Pushes a header's current size and date into the index and, on
+    // dircache volumes, into its record on disk
+    void refresh_node_locked(uint32_t block_num) {
+        const auto* block = get_block<FileBlock>(block_num);
+        if (!block) return;
         
-        update_checksum(file);
+        bool is_root = (block_num == root_block_num_);
+        Entry fresh = is_root ?
+            entry_from_root(reinterpret_cast<const RootBlock*>(block)) :
+            entry_from_header(block_num, block);
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            auto it = nodes_.find(block_num);
+            if (it == nodes_.end()) return;  // unlinked since
+            it->second.entry.size = fresh.size;
+            it->second.entry.mtime = fresh.mtime;
+        }
         
-        // Add to parent directory hash table
-        add_to_directory(parent_block, file_block, filename);
+        uint32_t parent = endian::from_big_endian(block->parent);
+        if (dircache_ && !is_root && parent != 0) update_dircache_record(parent, block_num, block);
+    }
+    
+    void refresh_node(uint32_t block_num) {
+        std::shared_lock<std::shared_mutex> header(header_lock(block_num));
+        refresh_node_locked(block_num);
+    }
+    
+    static std::pair<std::string, std::string> split_path(const std::string& path) {
+        size_t last_slash = path.find_last_of('/');
+        std::string parent_path = (last_slash == 0 || last_slash == std::string::npos) ?
+            "/" : path.substr(0, last_slash);
+        return {parent_path, path.substr(last_slash + 1)};
+    }
+    
+    // requires header_lock(block_num) held
+    Entry entry_from_header(uint32_t block_num, const FileBlock* block) {
+        Entry entry;
+        entry.name = BcplString::read(block->filename);
         
-        // Clear directory cache
-        dir_cache_.clear();
+        int32_t sec_type = endian::from_big_endian(block->sec_type);
+        entry.is_directory = (sec_type == ST_DIR);
+        entry.size = entry.is_directory ? 0 : endian::from_big_endian(block->file_size);
+        entry.block_num = block_num;
         
-        return 0;
+        uint32_t days = endian::from_big_endian(block->days);
+        uint32_t mins = endian::from_big_endian(block->mins);
+        uint32_t ticks = endian::from_big_endian(block->ticks);
+        entry.mtime = amiga_to_unix_time(days, mins, ticks);
+        return entry;
     }
     
-    int delete_file(const std::string& path) {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
-        if (read_only_) {
-            DBG(std::cerr << "DEBUG: delete_file failed - filesystem is read-only" << std::endl);
-            return -EROFS;
+    // Attributes read straight from a header block
+    Entry load_entry(uint32_t block_num) {
+        std::shared_lock<std::shared_mutex> header(header_lock(block_num));
+        const auto* block = get_block<FileBlock>(block_num);
+        if (!block) return Entry{};
+        return entry_from_header(block_num, block);
+    }
+    
+    // requires header_lock(root_block_num_) held
+    Entry entry_from_root(const RootBlock* root_block) {
+        Entry root;
+        root.name = "";
+        root.is_directory = true;
+        root.size = 0;
+        
+        uint32_t days = endian::from_big_endian(root_block->days);
+        uint32_t mins = endian::from_big_endian(root_block->mins);
+        uint32_t ticks = endian::from_big_endian(root_block->ticks);
+        root.mtime = amiga_to_unix_time(days, mins, ticks);
+        root.block_num = root_block_num_;
+        return root;
+    }
+    
+    Entry root_entry() {
+        std::shared_lock<std::shared_mutex> header(header_lock(root_block_num_));
+        auto* root_block = get_block<RootBlock>(root_block_num_);
+        if (root_block) return entry_from_root(root_block);
+        
+        Entry root;
+        root.name = "";
+        root.is_directory = true;
+        root.size = 0;
+        root.mtime = time(nullptr);
+        root.block_num = root_block_num_;
+        return root;
+    }
+    
+    bool is_directory_block(uint32_t block_num) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto it = nodes_.find(block_num);
+        return it != nodes_.end() && it->second.entry.is_directory;
+    }
+    
+    // requires fs_mutex_ held (shared is enough); takes dir_lock(parent_block)
+    // Creates a file (ST_FILE) or directory (ST_DIR) header in parent_block
+    int create_entry_unsafe(uint32_t parent_block, const std::string& name, int32_t sec_type,
+                            uint32_t& new_block) {
+        if (name.length() > BCPL_STRING_MAX) return -ENAMETOOLONG;
+        
+        std::lock_guard<std::shared_mutex> dir(dir_lock(parent_block));
+        if (!is_directory_block(parent_block)) return -ENOENT;
+        
+        // Check if entry already exists (case-insensitive for Amiga semantics)
+        if (lookup_unsafe(parent_block, name)) return -EEXIST;
+        
+        // Allocate new header block next to its directory
+        uint32_t header_block = allocate_block(parent_block);
+        if (header_block == 0) return -ENOSPC;
+        
+        // New directories on a dircache volume start with an empty cache block
+        uint32_t dc_block = 0;
+        if (dircache_ && sec_type == ST_DIR) {
+            dc_block = new_dircache_block(header_block);
+            if (dc_block == 0) {
+                free_block(header_block);
+                return -ENOSPC;
+            }
         }
         
-        auto entry = get_entry_unsafe(path);
+        // Initialize header block
+        {
+            std::lock_guard<std::shared_mutex> header_guard(header_lock(header_block));
+            auto* header = get_block_writable<FileBlock>(header_block);
+            if (!header) {
+                free_block(dc_block);
+                free_block(header_block);
+                return -EIO;
+            }
+            
+            std::memset(header, 0, BLOCK_SIZE);
+            header->type = endian::to_big_endian(static_cast<uint32_t>(T_HEADER));
+            header->header_key = endian::to_big_endian(header_block);
+            header->parent = endian::to_big_endian(parent_block);
+            header->sec_type = endian::to_big_endian(sec_type);
+            header->extension = endian::to_big_endian(dc_block);
+            
+            // Set name
+            BcplString::write(header->filename, name);
+            
+            // Set timestamps
+            auto [days, mins, ticks] = unix_to_amiga_time(time(nullptr));
+            header->days = endian::to_big_endian(days);
+            header->mins = endian::to_big_endian(mins);
+            header->ticks = endian::to_big_endian(ticks);
+            
+            update_checksum(header);
+        }
+        
+        // The record goes in first, as it is the step that can run out of space
+        if (!add_dircache_record(parent_block, header_block)) {
+            free_block(dc_block);
+            free_block(header_block);
+            return -ENOSPC;
+        }
+        
+        // Add to parent directory hash table
+        std::string folded = fold_name(name);
+        uint32_t hash = amiga_hash(folded);
+        add_to_directory(parent_block, header_block, hash);
+        
+        // Index the new header and pick up the parent's new date
+        index_node(parent_block, header_block, std::move(folded), hash);
+        refresh_node(parent_block);
+        
+        new_block = header_block;
+        return 0;
+    }
+    
+    // requires fs_mutex_ held (shared is enough); takes dir_lock(parent_block).
+    // The caller syncs afterwards, which needs fs_mutex_ exclusively.
+    int delete_file_unsafe(uint32_t parent_block, const std::string& filename) {
+        std::lock_guard<std::shared_mutex> dir(dir_lock(parent_block));
+        auto entry = lookup_unsafe(parent_block, filename);
         if (!entry) {
-            DBG(std::cerr << "DEBUG: delete_file failed - file not found: " << path << std::endl);
+            DBG(std::cerr << "DEBUG: delete_file failed - file not found: " << filename << std::endl);
             return -ENOENT;
         }
         if (entry->is_directory) {
-            DBG(std::cerr << "DEBUG: delete_file failed - path is directory: " << path << std::endl);
+            DBG(std::cerr << "DEBUG: delete_file failed - path is directory: " << filename << std::endl);
             return -EISDIR;
         }
         
-        DBG(std::cerr << "DEBUG: delete_file proceeding with file: " << path 
+        DBG(std::cerr << "DEBUG: delete_file proceeding with file: " << filename 
                   << " (block=" << entry->block_num << ")" << std::endl);
         
-        size_t last_slash = path.find_last_of('/');
-        std::string parent_path = (last_slash == 0) ? "/" : path.substr(0, last_slash);
-        uint32_t parent_block = find_directory_block(parent_path);
-        
         // Remove from parent directory
-        
-        remove_from_directory(parent_block, entry->block_num, entry->name);
-        
-        // Unlink hygiene: zero the file's hash_chain before freeing
-        if (auto* fb = get_block_writable<FileBlock>(entry->block_num)) {
-            fb->hash_chain = endian::to_big_endian(0u);
-            update_checksum(fb);
-        }
+        uint32_t hash = unindex_node(entry->block_num);
+        remove_from_directory(parent_block, entry->block_num, hash);
+        remove_dircache_record(parent_block, entry->block_num);
+        refresh_node(parent_block);
         
         // Validate root block integrity after directory modification
         if (parent_block == root_block_num_) {
+            std::shared_lock<std::shared_mutex> header(header_lock(root_block_num_));
             const auto* root = get_block<RootBlock>(root_block_num_);
             if (root) {
                 uint32_t calculated = calculate_checksum(root, 5);
@@ -1121,45 +2205,74 @@ public:
             }
         }
         
-        // Free data blocks
-        auto* file = get_block<FileBlock>(entry->block_num);
-        if (file) {
-            uint32_t data_block = endian::from_big_endian(file->first_data);
-            while (data_block != 0) {
-                auto* data = get_block<DataBlock>(data_block);
-                if (!data) break;
-                
-                // Defensive check against corruption
-                if (endian::from_big_endian(data->type) != static_cast<uint32_t>(T_DATA) ||
-                    endian::from_big_endian(data->header_key) != entry->block_num) {
-                    break; // Stop on corruption
+        // Waits out readers and writers of the file itself
+        {
+            std::lock_guard<std::shared_mutex> header(header_lock(entry->block_num));
+            
+            // Unlink hygiene: zero the file's hash_chain before freeing
+            if (auto* fb = get_block_writable<FileBlock>(entry->block_num)) {
+                set_checksummed(fb, fb->hash_chain, 0u);
+            }
+            
+            // An open file keeps its blocks until its last release_file
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex_);
+                if (open_files_.count(entry->block_num)) {
+                    orphans_.insert(entry->block_num);
+                    return 0;
                 }
-                
-                uint32_t next = endian::from_big_endian(data->next_data);
-                free_block(data_block);
-                data_block = next;
             }
+            free_file_locked(entry->block_num);
         }
         
-        // Free file block
-        free_block(entry->block_num);
-        
-        // Clear cache and sync to disk
-        dir_cache_.clear();
-        sync_to_disk();
-        
         return 0;
     }
     
-    int truncate_file(const std::string& path, off_t size) {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
-        if (read_only_) return -EROFS;
-        
-        auto entry = get_entry_unsafe(path);
-        if (!entry) return -ENOENT;
-        if (entry->is_directory) return -EISDIR;
+    // requires fs_mutex_ held (shared is enough) and header_lock(block_num)
+    // held exclusively, or fs_mutex_ held exclusively.
+    // Frees an unlinked file's data blocks and header
+    void free_file_locked(uint32_t block_num) {
+        for (uint32_t data_block : get_block_index(block_num).blocks) {
+            free_block(data_block);
+        }
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            block_index_.erase(block_num);
+        }
+        free_header(block_num);
+    }
+    
+    // requires fs_mutex_ held (shared is enough)
+    void free_header(uint32_t block_num) {
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            generations_[block_num]++;
+        }
+        free_block(block_num);
+    }
+    
+    // requires header_lock(block_num) held.
+    // 0 if the header is a file that can still be read and written: indexed,
+    // or unlinked but open. Headers are only freed under their header lock.
+    int live_file_locked(uint32_t block_num) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto it = nodes_.find(block_num);
+        if (it != nodes_.end()) return it->second.entry.is_directory ? -EISDIR : 0;
+        return orphans_.count(block_num) ? 0 : -ENOENT;
+    }
+    
+    // requires fs_mutex_ held (shared is enough) and header_lock(file_block_num)
+    // held exclusively
+    int truncate_file_unsafe(uint32_t file_block_num, off_t size) {
+        // The block may have been deleted and reused since the caller's lookup
+        const auto* current = get_block<FileBlock>(file_block_num);
+        if (!current) return -EIO;
+        if (endian::from_big_endian(current->type) != static_cast<uint32_t>(T_HEADER) ||
+            endian::from_big_endian(current->sec_type) != ST_FILE) {
+            return -ENOENT;
+        }
         
-        auto* file = get_block_writable<FileBlock>(entry->block_num);
+        auto* file = get_block_writable<FileBlock>(file_block_num);
         if (!file) return -EIO;
         
         uint32_t current_size = endian::from_big_endian(file->file_size);
@@ -1169,223 +2282,306 @@ public:
         if (size < current_size) {
             // Truncate - free excess data blocks
             uint32_t blocks_needed = (size + 487) / 488;
-            uint32_t current_blocks = (current_size + 487) / 488;
+            auto& index = get_block_index(file_block_num);
             
-            if (blocks_needed < current_blocks) {
-                // Find and free excess blocks
-                uint32_t block_count = 0;
-                uint32_t data_block = endian::from_big_endian(file->first_data);
-                uint32_t prev_block = 0;
-                
-                while (data_block != 0 && block_count < blocks_needed) {
-                    prev_block = data_block;
-                    auto* data = get_block<DataBlock>(data_block);
-                    if (!data) break;
-                    
-                    // Defensive check against corruption
-                    if (endian::from_big_endian(data->type) != static_cast<uint32_t>(T_DATA) ||
-                        endian::from_big_endian(data->header_key) != entry->block_num) {
-                        break; // Stop on corruption
-                    }
-                    
-                    data_block = endian::from_big_endian(data->next_data);
-                    block_count++;
-                }
-                
-                // Free remaining blocks
-                while (data_block != 0) {
-                    auto* data = get_block<DataBlock>(data_block);
-                    if (!data) break;
-                    
-                    // Defensive check against corruption
-                    if (endian::from_big_endian(data->type) != static_cast<uint32_t>(T_DATA) ||
-                        endian::from_big_endian(data->header_key) != entry->block_num) {
-                        break; // Stop on corruption
-                    }
-                    
-                    uint32_t next = endian::from_big_endian(data->next_data);
-                    free_block(data_block);
-                    data_block = next;
-                }
-                
-                // Update last block's next pointer and data_size
-                if (prev_block != 0) {
-                    auto* data = get_block_writable<DataBlock>(prev_block);
-                    if (data) {
-                        data->next_data = endian::to_big_endian(0u);
-                        // Set correct data_size for the truncated block with clamping
-                        uint32_t remainder = static_cast<uint32_t>(size % 488);
-                        if (remainder == 0 && size > 0) remainder = 488;
-                        if (remainder > 488u) remainder = 488u; // Defensive clamp
-                        data->data_size = endian::to_big_endian(remainder);
-                        update_checksum(data);
+            trim_chain(file, index, blocks_needed);
+            
+            // The last block keeps only the bytes below the new size, even when
+            // no block was freed, so growing the file again reads zeros there
+            if (blocks_needed > 0 && blocks_needed <= index.blocks.size()) {
+                auto* data = get_block_writable<DataBlock>(index.blocks[blocks_needed - 1]);
+                if (data) {
+                    uint32_t remainder = static_cast<uint32_t>(size - (blocks_needed - 1) * 488);
+                    if (endian::from_big_endian(data->data_size) > remainder) {
+                        set_checksummed(data, data->data_size, remainder);
                     }
-                } else if (size == 0) {
-                    // Truncated to zero - clear first_data
-                    file->first_data = endian::to_big_endian(0u);
                 }
             }
         }
         
         // Update file size
-        file->file_size = endian::to_big_endian(static_cast<uint32_t>(size));
+        set_checksummed(file, file->file_size, static_cast<uint32_t>(size));
         
         // Update high_seq to reflect last data block sequence index
         uint32_t blocks = (static_cast<uint32_t>(size) + 487) / 488;
-        file->high_seq = endian::to_big_endian(blocks ? (blocks - 1) : 0u);
+        set_checksummed(file, file->high_seq, blocks ? (blocks - 1) : 0u);
         
         // Update timestamp after truncation
         touch_fileblock(file);
-        update_checksum(file);
+        refresh_node_locked(file_block_num);
         
         return 0;
     }
     
-    int create_directory(const std::string& path, mode_t) {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
-        if (read_only_) return -EROFS;
+    // requires fs_mutex_ held (shared is enough) and the file's header_lock
+    // held exclusively
+    // Frees every chain block past the first keep and ends the chain there
+    void trim_chain(FileBlock* file, BlockIndex& index, size_t keep) {
+        if (keep >= index.blocks.size()) return;
+        for (size_t i = keep; i < index.blocks.size(); ++i) {
+            free_block(index.blocks[i]);
+        }
+        index.blocks.resize(keep);
         
-        size_t last_slash = path.find_last_of('/');
-        std::string parent_path = (last_slash == 0) ? "/" : path.substr(0, last_slash);
-        std::string dirname = path.substr(last_slash + 1);
+        // Update last block's next pointer
+        if (!index.blocks.empty()) {
+            auto* data = get_block_writable<DataBlock>(index.blocks.back());
+            if (data) set_checksummed(data, data->next_data, 0u);
+        } else {
+            // Trimmed to zero - clear first_data
+            set_checksummed(file, file->first_data, 0u);
+        }
+    }
+    
+    // requires fs_mutex_ held (shared is enough) and header_lock(file_block_num)
+    // held exclusively
+    int allocate_file_unsafe(uint32_t file_block_num, size_t end, bool keep_size) {
+        // The block may have been deleted and reused since the caller's lookup
+        const auto* current = get_block<FileBlock>(file_block_num);
+        if (!current) return -EIO;
+        if (endian::from_big_endian(current->type) != static_cast<uint32_t>(T_HEADER) ||
+            endian::from_big_endian(current->sec_type) != ST_FILE) {
+            return -ENOENT;
+        }
         
-        if (dirname.length() > BCPL_STRING_MAX) return -ENAMETOOLONG;
+        auto* file = get_block_writable<FileBlock>(file_block_num);
+        if (!file) return -EIO;
         
-        // Check if directory already exists (case-insensitive for Amiga semantics)
-        if (auto ents = list_directory_unsafe(parent_path)) {
-            for (const auto& e : *ents) {
-                if (equals_icase_ascii(e.name, dirname)) return -EEXIST;
+        auto& index = get_block_index(file_block_num);
+        if (index.corrupt) return -EIO;
+        
+        size_t count = (end + 487) / 488;
+        if (index.blocks.size() < count) {
+            size_t original = index.blocks.size();
+            {
+                // Cheap refusal up front; a writer on another file can still
+                // take the blocks in between, which the rollback below covers
+                std::lock_guard<std::mutex> alloc(alloc_mutex_);
+                if (count - original > free_map_.free_count()) return -ENOSPC;
+            }
+            grow_chain(file_block_num, file, index, count, 0, 0);
+            if (index.blocks.size() < count) {
+                // Failed fallocate leaves the file as it was
+                trim_chain(file, index, original);
+                return -ENOSPC;
             }
         }
         
-        // Find parent directory
-        uint32_t parent_block = find_directory_block(parent_path);
-        if (parent_block == 0) return -ENOENT;
-        
-        // Allocate new directory block
-        uint32_t dir_block = allocate_block();
-        if (dir_block == 0) return -ENOSPC;
-        
-        // Initialize directory block
-        auto* dir = get_block_writable<FileBlock>(dir_block);
-        if (!dir) {
-            free_block(dir_block);
-            return -EIO;
+        uint32_t current_size = endian::from_big_endian(file->file_size);
+        if (keep_size || end <= current_size) return 0;
+        
+        // AmigaDOS reads a block's data_size bytes, so the blocks inside the new
+        // size must claim their zeros. Everything past the old EOF is cleared,
+        // whatever data_size says, so no bytes cut off by a shrink come back.
+        for (size_t idx = current_size / 488; idx < count; ++idx) {
+            auto* data = get_block_writable<DataBlock>(index.blocks[idx]);
+            if (!data) return -EIO;
+            uint32_t live = static_cast<uint32_t>(current_size - idx * 488);
+            if (current_size < idx * 488) live = 0;
+            uint32_t new_size = static_cast<uint32_t>(std::min<size_t>(488, end - idx * 488));
+            if (new_size <= live) continue;
+            std::memset(data->data + live, 0, new_size - live);
+            data->data_size = endian::to_big_endian(new_size);
+            update_checksum(data);
         }
         
-        std::memset(dir, 0, BLOCK_SIZE);
-        dir->type = endian::to_big_endian(static_cast<uint32_t>(T_HEADER));
-        dir->header_key = endian::to_big_endian(dir_block);
-        dir->parent = endian::to_big_endian(parent_block);
-        dir->sec_type = endian::to_big_endian(ST_DIR);
-        
-        // Set directory name
-        BcplString::write(dir->filename, dirname);
-        
-        // Set timestamps
-        auto [days, mins, ticks] = unix_to_amiga_time(time(nullptr));
-        dir->days = endian::to_big_endian(days);
-        dir->mins = endian::to_big_endian(mins);
-        dir->ticks = endian::to_big_endian(ticks);
-        
-        update_checksum(dir);
-        
-        // Add to parent directory
-        add_to_directory(parent_block, dir_block, dirname);
-        
-        // Clear cache
-        dir_cache_.clear();
+        set_checksummed(file, file->file_size, static_cast<uint32_t>(end));
+        set_checksummed(file, file->high_seq, static_cast<uint32_t>(count - 1));
+        touch_fileblock(file);
+        refresh_node_locked(file_block_num);
         
         return 0;
     }
     
-    int delete_directory(const std::string& path) {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
-        if (read_only_) return -EROFS;
-        if (path == "/" || path.empty()) return -EINVAL;
-        
-        auto entry = get_entry_unsafe(path);
+    // requires fs_mutex_ held exclusively, so no directory locks are needed
+    int delete_directory_unsafe(uint32_t parent_block, const std::string& dirname) {
+        auto entry = lookup_unsafe(parent_block, dirname);
         if (!entry) return -ENOENT;
         if (!entry->is_directory) return -ENOTDIR;
         
         // Check if directory is empty
-        auto contents = list_directory_unsafe(path);
+        auto contents = list_directory_at_unsafe(entry->block_num);
         if (contents && !contents->empty()) return -ENOTEMPTY;
         
-        size_t last_slash = path.find_last_of('/');
-        std::string parent_path = (last_slash == 0) ? "/" : path.substr(0, last_slash);
-        uint32_t parent_block = find_directory_block(parent_path);
-        
         // Remove from parent directory
-        remove_from_directory(parent_block, entry->block_num, entry->name);
+        uint32_t hash = unindex_node(entry->block_num);
+        remove_from_directory(parent_block, entry->block_num, hash);
+        remove_dircache_record(parent_block, entry->block_num);
+        refresh_node(parent_block);
         
-        // Free directory block
-        free_block(entry->block_num);
+        // Free directory block and its dircache chain
+        free_dircache_chain(entry->block_num);
+        free_header(entry->block_num);
         
-        // Clear cache and sync to disk
-        dir_cache_.clear();
-        sync_to_disk();
+        // Sync to disk
+        sync_after_op_unsafe();
         
         return 0;
     }
     
-    const std::string& volume_name() const { return volume_name_; }
-    bool is_ffs() const { return is_ffs_; }
-    
-    void clear_cache() {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
-        dir_cache_.clear();
-    }
-    
-    void sync_to_disk() {
-        if (mapped_data_ && !read_only_) {
-            msync(mapped_data_, file_size_, MS_SYNC);
-            // Also ensure kernel writes complete
-            fsync(fd_);
+    // requires fs_mutex_ held (shared is enough)
+    // and header_lock(file_block_num) held.
+    // Returns the logical block map for a file, walking next_data once on first use.
+    // Concurrent readers may both build it; the first insert wins. The entry is
+    // only modified with the header lock held exclusively, so the reference
+    // stays valid for as long as the caller holds it.
+    BlockIndex& get_block_index(uint32_t file_block_num) {
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            auto it = block_index_.find(file_block_num);
+            if (it != block_index_.end()) {
+                return it->second;
+            }
         }
+        
+        BlockIndex index;
+        const auto* file_block = get_block<FileBlock>(file_block_num);
+        uint32_t cur = file_block ? endian::from_big_endian(file_block->first_data) : 0;
+        size_t max_blocks = total_blocks();
+        
+        while (cur != 0) {
+            const auto* db = get_block<DataBlock>(cur);
+            
+            // Defensive check against corruption (also bounds cyclic chains)
+            if (!db || index.blocks.size() >= max_blocks ||
+                endian::from_big_endian(db->type) != static_cast<uint32_t>(T_DATA) ||
+                endian::from_big_endian(db->header_key) != file_block_num) {
+                index.corrupt = true;
+                break;
+            }
+            
+            index.blocks.push_back(cur);
+            cur = endian::from_big_endian(db->next_data);
+        }
+        
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        return block_index_.emplace(file_block_num, std::move(index)).first->second;
     }
     
-    size_t get_actual_file_size(uint32_t file_block_num) {
-        std::lock_guard<std::mutex> lock(fs_mutex_);
+    // requires fs_mutex_ held (shared is enough) and header_lock(file_block_num) held
+    // Walks [offset, offset + size) of a file, calling fn(src, len) for each
+    // contiguous payload span; src is nullptr for holes and bytes past data_size
+    template<typename Fn>
+    void for_each_payload(uint32_t file_block_num, size_t offset, size_t size, Fn&& fn) {
+        const auto& index = get_block_index(file_block_num);
         
-        const auto* file_block = get_block<FileBlock>(file_block_num);
-        if (!file_block) return 0;
+        size_t cur_idx = offset / 488;
+        size_t pos_in_block = offset % 488;
+        size_t produced = 0;
         
-        return static_cast<size_t>(endian::from_big_endian(file_block->file_size));
+        while (produced < size) {
+            size_t need = std::min<size_t>(size - produced, 488 - pos_in_block);
+            
+            // Past the indexed chain: hole, zero-fill this logical block
+            const DataBlock* db = nullptr;
+            if (cur_idx < index.blocks.size()) {
+                db = get_block<DataBlock>(index.blocks[cur_idx]);
+            }
+            
+            if (db) {
+                uint32_t db_size = std::min<uint32_t>(488u, endian::from_big_endian(db->data_size));
+                if (pos_in_block < db_size) {
+                    size_t take = std::min<size_t>(need, db_size - pos_in_block);
+                    fn(db->data + pos_in_block, take);
+                    produced += take;
+                    need -= take;
+                }
+            }
+            if (need) { // inside logical block but past data_size => zeros
+                fn(nullptr, need);
+                produced += need;
+            }
+            
+            pos_in_block = 0;
+            ++cur_idx;
+        }
     }
     
-private:
-    // requires fs_mutex_ held
-    [[nodiscard]] std::optional<std::vector<Entry>> get_cached_dir(const std::string& path) {
-        auto it = dir_cache_.find(path);
-        if (it != dir_cache_.end()) {
-            return it->second;
+    // requires fs_mutex_ held (shared is enough)
+    // Where the next `count` data blocks of a file should go: the start of a
+    // free run that long after its last block (or its header), else anywhere
+    // on the disk, else just past the last block and let allocation scatter
+    uint32_t data_goal(uint32_t file_block_num, const BlockIndex& index, size_t count) {
+        uint32_t last = index.blocks.empty() ? file_block_num : index.blocks.back();
+        
+        std::lock_guard<std::mutex> lock(alloc_mutex_);
+        uint32_t want = static_cast<uint32_t>(std::min<size_t>(count, free_map_.size()));
+        uint32_t start = free_map_.find_free_run(want, last + 1);
+        if (start == 0) start = free_map_.find_free_run(want, root_block_num_);
+        if (start == 0) start = free_map_.find_free_run(want);
+        return start ? start : last + 1;
+    }
+    
+    // requires fs_mutex_ held (shared is enough) and header_lock(file_block_num)
+    // held exclusively
+    // Extends the file's chain to `count` blocks an extent at a time. Blocks at
+    // chain positions [overwrite_from, overwrite_to) are about to get all 488
+    // payload bytes from the caller, who checksums them afterwards, so only
+    // their headers are filled in; the rest are zeroed and checksummed here.
+    // Stops short if the disk fills up.
+    void grow_chain(uint32_t file_block_num, FileBlock* file_block, BlockIndex& index, size_t count,
+                    size_t overwrite_from, size_t overwrite_to) {
+        uint32_t goal = data_goal(file_block_num, index, count - index.blocks.size());
+        while (index.blocks.size() < count) {
+            uint32_t got = 0;
+            uint32_t start = allocate_extent(goal, static_cast<uint32_t>(count - index.blocks.size()), got);
+            if (start == 0) return;
+            
+            for (uint32_t i = 0; i < got; i++) {
+                auto* new_data = get_block_writable<DataBlock>(start + i);
+                if (!new_data) return;
+                
+                size_t pos = index.blocks.size() + i;
+                bool overwritten = pos >= overwrite_from && pos < overwrite_to;
+                std::memset(new_data, 0, overwritten ? offsetof(DataBlock, data) : BLOCK_SIZE);
+                new_data->type = endian::to_big_endian(static_cast<uint32_t>(T_DATA));
+                new_data->header_key = endian::to_big_endian(file_block_num);
+                new_data->seq_num = endian::to_big_endian(static_cast<uint32_t>(pos + 1));
+                new_data->next_data = endian::to_big_endian(i + 1 < got ? start + i + 1 : 0);
+                if (!overwritten) update_checksum(new_data);
+            }
+            
+            // Link the extent into the chain
+            if (!index.blocks.empty()) {
+                auto* prev_data = get_block_writable<DataBlock>(index.blocks.back());
+                if (prev_data) {
+                    set_checksummed(prev_data, prev_data->next_data, start);
+                }
+            } else {
+                set_checksummed(file_block, file_block->first_data, start);
+            }
+            
+            for (uint32_t i = 0; i < got; i++) index.blocks.push_back(start + i);
+            goal = start + got;
         }
-        return std::nullopt;
     }
     
-    // requires fs_mutex_ held
-    void cache_directory(const std::string& path, const std::vector<Entry>& entries) {
-        dir_cache_[path] = entries;
+    // Walks path one component at a time from the root; 0 if any part is missing
+    uint32_t resolve_path(const std::string& path) {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        uint32_t block = root_block_num_;
+        size_t pos = 0;
+        while (block != 0 && pos < path.size()) {
+            size_t end = path.find('/', pos);
+            if (end == std::string::npos) end = path.size();
+            if (end > pos) {
+                block = child_block_locked(block, std::string_view(path).substr(pos, end - pos));
+            }
+            pos = end + 1;
+        }
+        return block;
     }
     
     uint32_t find_directory_block(const std::string& path) {
-        if (path == "/" || path.empty()) {
-            return root_block_num_;
-        }
-        
-        auto entry = get_entry_unsafe(path);
-        if (entry && entry->is_directory) {
-            return entry->block_num;
-        }
-        
-        return 0;
+        uint32_t block = resolve_path(path);
+        return (block != 0 && is_directory_block(block)) ? block : 0;
     }
     
-    void add_to_directory(uint32_t dir_block, uint32_t file_block, const std::string& name) {
-        uint32_t hash = hash_name(name);
-        
-        DBG(std::cerr << "DEBUG: add_to_directory: name='" << name << "' hash=" << hash 
+    // requires dir_lock(dir_block) held exclusively, or fs_mutex_ held exclusively.
+    // The hash table and chain links are stable under the directory lock; each
+    // header they live in is patched under its own header lock, one at a time.
+    void add_to_directory(uint32_t dir_block, uint32_t file_block, uint32_t hash) {
+        DBG(std::cerr << "DEBUG: add_to_directory: hash=" << hash 
                   << " file_block=" << file_block << " dir_block=" << dir_block << std::endl);
         
         if (dir_block == root_block_num_) {
@@ -1395,46 +2591,49 @@ private:
             uint32_t existing = endian::from_big_endian(root->hash_table[hash]);
             DBG(std::cerr << "DEBUG: root hash_table[" << hash << "] was " << existing 
                       << ", setting to " << file_block << std::endl);
-                      
-            root->hash_table[hash] = endian::to_big_endian(file_block);
             
             // Link to existing chain
-            auto* file = get_block_writable<FileBlock>(file_block);
-            if (file) {
-                file->hash_chain = endian::to_big_endian(existing);
-                DBG(std::cerr << "DEBUG: Set file->hash_chain to " << existing << std::endl);
-                update_checksum(file);
-            }
+            set_hash_chain(file_block, existing);
+            DBG(std::cerr << "DEBUG: Set file->hash_chain to " << existing << std::endl);
             
+            std::lock_guard<std::shared_mutex> header(header_lock(dir_block));
+            set_checksummed(root, root->hash_table[hash], file_block);
             touch_rootblock(root);
-            update_checksum(root);
         } else {
             auto* dir = get_block_writable<FileBlock>(dir_block);
             if (!dir) return;
             
             uint32_t existing = endian::from_big_endian(dir->data_blocks[hash]);
-            dir->data_blocks[hash] = endian::to_big_endian(file_block);
             
             // Link to existing chain
-            auto* file = get_block_writable<FileBlock>(file_block);
-            if (file) {
-                file->hash_chain = endian::to_big_endian(existing);
-                update_checksum(file);
-            }
+            set_hash_chain(file_block, existing);
             
+            std::lock_guard<std::shared_mutex> header(header_lock(dir_block));
+            set_checksummed(dir, dir->data_blocks[hash], file_block);
             touch_fileblock(dir);
-            update_checksum(dir);
         }
     }
     
-    void remove_from_directory(uint32_t dir_block, uint32_t file_block, const std::string&) {
+    // Patches a header's hash_chain under its header lock
+    void set_hash_chain(uint32_t header_block, uint32_t next) {
+        std::lock_guard<std::shared_mutex> header(header_lock(header_block));
+        if (auto* fb = get_block_writable<FileBlock>(header_block)) {
+            set_checksummed(fb, fb->hash_chain, next);
+        }
+    }
+    
+    // requires dir_lock(dir_block) held exclusively, or fs_mutex_ held exclusively.
+    // Starts at the bucket the file was indexed under, which is where it
+    // normally is, then moves on through the rest.
+    void remove_from_directory(uint32_t dir_block, uint32_t file_block, uint32_t start) {
         
         if (dir_block == root_block_num_) {
             auto* root = get_block_writable<RootBlock>(dir_block);
             if (!root) return;
             
             // Search ALL hash buckets to find the file (Amiga filesystems can have corruption)
-            for (int hash = 0; hash < HASH_TABLE_SIZE; hash++) {
+            for (size_t i = 0; i < HASH_TABLE_SIZE; i++) {
+                size_t hash = (start + i) % HASH_TABLE_SIZE;
                 uint32_t current = endian::from_big_endian(root->hash_table[hash]);
                 if (current == 0) continue;
                 
@@ -1443,17 +2642,16 @@ private:
                     
                     auto* file = get_block<FileBlock>(file_block);
                     uint32_t next_in_chain = file ? endian::from_big_endian(file->hash_chain) : 0;
-                    root->hash_table[hash] = endian::to_big_endian(next_in_chain);
+                    std::lock_guard<std::shared_mutex> header(header_lock(dir_block));
+                    set_checksummed(root, root->hash_table[hash], next_in_chain);
                     touch_rootblock(root);
-                    update_checksum(root);
                     return; // Found and removed
                 }
                 
                 // Search the chain
                 if (remove_from_chain(current, file_block)) {
-                    
+                    std::lock_guard<std::shared_mutex> header(header_lock(dir_block));
                     touch_rootblock(root);
-                    update_checksum(root);
                     return; // Found and removed
                 }
             }
@@ -1464,49 +2662,324 @@ private:
             if (!dir) return;
             
             // Search ALL hash buckets for subdirectories too
-            for (int hash = 0; hash < HASH_TABLE_SIZE; hash++) {
+            for (size_t i = 0; i < HASH_TABLE_SIZE; i++) {
+                size_t hash = (start + i) % HASH_TABLE_SIZE;
                 uint32_t current = endian::from_big_endian(dir->data_blocks[hash]);
                 if (current == 0) continue;
                 
                 if (current == file_block) {
                     auto* file = get_block<FileBlock>(file_block);
-                    dir->data_blocks[hash] = file ? endian::to_big_endian(endian::from_big_endian(file->hash_chain)) : 0;
+                    std::lock_guard<std::shared_mutex> header(header_lock(dir_block));
+                    set_checksummed(dir, dir->data_blocks[hash], file ? endian::from_big_endian(file->hash_chain) : 0u);
                     touch_fileblock(dir);
-                    update_checksum(dir);
                     return; // Found and removed
                 }
                 
                 if (remove_from_chain(current, file_block)) {
+                    std::lock_guard<std::shared_mutex> header(header_lock(dir_block));
                     touch_fileblock(dir);
-                    update_checksum(dir);
                     return; // Found and removed
                 }
             }
         }
     }
     
-    bool remove_from_chain(uint32_t start_block, uint32_t target_block) {
-        uint32_t current = start_block;
+    bool remove_from_chain(uint32_t start_block, uint32_t target_block) {
+        uint32_t current = start_block;
+        
+        while (current != 0) {
+            const auto* block = get_block<FileBlock>(current);
+            if (!block) break;
+            
+            uint32_t next = endian::from_big_endian(block->hash_chain);
+            if (next == target_block) {
+                // Found it - unlink with proper endian conversion
+                uint32_t next2 = 0;
+                if (auto* target = get_block<FileBlock>(target_block)) {
+                    next2 = endian::from_big_endian(target->hash_chain);
+                }
+                set_hash_chain(current, next2);
+                return true;
+            }
+            
+            current = next;
+        }
+        return false;
+    }
+    
+    // Dircache records. Fixed part: header, size, protect, uid, gid, days,
+    // mins, ticks, type and name_len; then the name, comment_len and comment.
+    static constexpr size_t DIRC_FIXED = 24;
+    static constexpr size_t COMMENT_MAX = sizeof(FileBlock::comment) - 1;
+    static constexpr size_t DIRC_RECORD_MAX = DIRC_FIXED + BCPL_STRING_MAX + 1 + COMMENT_MAX + 1;
+    
+    static uint32_t load_be32(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return endian::from_big_endian(v);
+    }
+    
+    static uint16_t load_be16(const uint8_t* p) {
+        uint16_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return endian::from_big_endian(v);
+    }
+    
+    static void store_be32(uint8_t* p, uint32_t v) {
+        v = endian::to_big_endian(v);
+        std::memcpy(p, &v, sizeof(v));
+    }
+    
+    static void store_be16(uint8_t* p, uint16_t v) {
+        v = endian::to_big_endian(v);
+        std::memcpy(p, &v, sizeof(v));
+    }
+    
+    // Length of the record at rec, padding included, or 0 if it overruns avail
+    static size_t dircache_record_len(const uint8_t* rec, size_t avail) {
+        if (avail < DIRC_FIXED + 1) return 0;
+        size_t name_len = rec[23];
+        if (DIRC_FIXED + name_len + 1 > avail) return 0;
+        size_t len = DIRC_FIXED + name_len + 1 + rec[DIRC_FIXED + name_len];
+        len = (len + 1) & ~size_t{1};
+        return len <= avail ? len : 0;
+    }
+    
+    // Bytes taken by a dircache block's records, or nullopt if they overrun it
+    static std::optional<size_t> dircache_used(const DirCacheBlock* dc) {
+        uint32_t count = endian::from_big_endian(dc->records_nb);
+        size_t used = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            size_t len = dircache_record_len(dc->records + used, sizeof(dc->records) - used);
+            if (len == 0) return std::nullopt;
+            used += len;
+        }
+        return used;
+    }
+    
+    // Offset of file_block's record in dc, or nullopt
+    static std::optional<size_t> find_dircache_record(const DirCacheBlock* dc, uint32_t file_block) {
+        uint32_t count = endian::from_big_endian(dc->records_nb);
+        size_t off = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (load_be32(dc->records + off) == file_block) return off;
+            off += dircache_record_len(dc->records + off, sizeof(dc->records) - off);
+        }
+        return std::nullopt;
+    }
+    
+    // requires dircache_mutex_ held.
+    // Blocks of dir_block's dircache chain, or none if the volume has no
+    // dircache or any block fails its type, owner, checksum or record checks.
+    // Callers then fall back to the hash table and leave the chain alone.
+    std::vector<uint32_t> dircache_chain(uint32_t dir_block) {
+        std::vector<uint32_t> chain;
+        if (!dircache_) return chain;
+        const auto* dir = get_block<FileBlock>(dir_block);
+        if (!dir) return chain;
+        
+        // extension is set when the directory is created and never changes
+        uint32_t dc_block = endian::from_big_endian(dir->extension);
+        while (dc_block != 0) {
+            const auto* dc = get_block<DirCacheBlock>(dc_block);
+            if (!dc || chain.size() >= total_blocks() ||
+                endian::from_big_endian(dc->type) != static_cast<uint32_t>(T_DIRCACHE) ||
+                endian::from_big_endian(dc->header_key) != dc_block ||
+                endian::from_big_endian(dc->parent) != dir_block ||
+                endian::from_big_endian(dc->checksum) != calculate_checksum(dc) ||
+                !dircache_used(dc)) {
+                return {};
+            }
+            chain.push_back(dc_block);
+            dc_block = endian::from_big_endian(dc->next_dirc);
+        }
+        return chain;
+    }
+    
+    // Listing from the directory's dircache chain: one sequential read per
+    // 488 bytes of records instead of one read per header
+    [[nodiscard]] std::optional<std::vector<Entry>> read_dircache(uint32_t dir_block) {
+        std::lock_guard<std::mutex> lock(dircache_mutex_);
+        auto chain = dircache_chain(dir_block);
+        if (chain.empty()) return std::nullopt;
+        
+        std::vector<Entry> entries;
+        for (uint32_t dc_block : chain) {
+            const auto* dc = get_block<DirCacheBlock>(dc_block);
+            uint32_t count = endian::from_big_endian(dc->records_nb);
+            size_t off = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint8_t* rec = dc->records + off;
+                Entry entry;
+                entry.block_num = load_be32(rec);
+                entry.is_directory = static_cast<int8_t>(rec[22]) == ST_DIR;
+                entry.size = entry.is_directory ? 0 : load_be32(rec + 4);
+                entry.mtime = amiga_to_unix_time(load_be16(rec + 16), load_be16(rec + 18),
+                                                 load_be16(rec + 20));
+                entry.name.assign(reinterpret_cast<const char*>(rec + DIRC_FIXED),
+                                  std::min<size_t>(rec[23], BCPL_STRING_MAX));
+                if (!entry.name.empty()) entries.push_back(std::move(entry));
+                off += dircache_record_len(rec, sizeof(dc->records) - off);
+            }
+        }
+        return entries;
+    }
+    
+    // requires header_lock(file_block) held.
+    // Packs a header's attributes into a record; returns its length
+    size_t make_dircache_record(uint32_t file_block, const FileBlock* fb, uint8_t* rec) {
+        std::memset(rec, 0, DIRC_RECORD_MAX);
+        store_be32(rec, file_block);
+        store_be32(rec + 4, endian::from_big_endian(fb->file_size));
+        store_be32(rec + 8, endian::from_big_endian(fb->protect));
+        store_be16(rec + 12, endian::from_big_endian(fb->uid));
+        store_be16(rec + 14, endian::from_big_endian(fb->gid));
+        store_be16(rec + 16, static_cast<uint16_t>(endian::from_big_endian(fb->days)));
+        store_be16(rec + 18, static_cast<uint16_t>(endian::from_big_endian(fb->mins)));
+        store_be16(rec + 20, static_cast<uint16_t>(endian::from_big_endian(fb->ticks)));
+        rec[22] = static_cast<uint8_t>(endian::from_big_endian(fb->sec_type));
+        
+        size_t name_len = std::min<size_t>(fb->filename[0], BCPL_STRING_MAX);
+        rec[23] = static_cast<uint8_t>(name_len);
+        std::memcpy(rec + DIRC_FIXED, fb->filename + 1, name_len);
+        
+        size_t comment_len = std::min<size_t>(fb->comment[0], COMMENT_MAX);
+        rec[DIRC_FIXED + name_len] = static_cast<uint8_t>(comment_len);
+        std::memcpy(rec + DIRC_FIXED + name_len + 1, fb->comment + 1, comment_len);
+        
+        return (DIRC_FIXED + name_len + 1 + comment_len + 1) & ~size_t{1};
+    }
+    
+    // requires fs_mutex_ held (shared is enough).
+    // Allocates an empty dircache block owned by dir_block; 0 if the disk is full
+    uint32_t new_dircache_block(uint32_t dir_block) {
+        uint32_t dc_block = allocate_block(dir_block);
+        if (dc_block == 0) return 0;
+        auto* dc = get_block_writable<DirCacheBlock>(dc_block);
+        if (!dc) {
+            free_block(dc_block);
+            return 0;
+        }
+        dc->type = endian::to_big_endian(static_cast<uint32_t>(T_DIRCACHE));
+        dc->header_key = endian::to_big_endian(dc_block);
+        dc->parent = endian::to_big_endian(dir_block);
+        update_checksum(dc);
+        return dc_block;
+    }
+    
+    // requires dir_lock(dir_block) held exclusively, or fs_mutex_ held exclusively.
+    // Appends file_block's record to the first block with room, growing the
+    // chain by a block if none has any. False only if that block can't be had.
+    bool add_dircache_record(uint32_t dir_block, uint32_t file_block) {
+        if (!dircache_) return true;
+        
+        std::array<uint8_t, DIRC_RECORD_MAX> rec;
+        size_t len;
+        {
+            std::shared_lock<std::shared_mutex> header(header_lock(file_block));
+            const auto* fb = get_block<FileBlock>(file_block);
+            if (!fb) return false;
+            len = make_dircache_record(file_block, fb, rec.data());
+        }
+        
+        std::lock_guard<std::mutex> lock(dircache_mutex_);
+        auto chain = dircache_chain(dir_block);
+        if (chain.empty()) return true;
+        
+        uint32_t target = 0;
+        for (uint32_t dc_block : chain) {
+            if (*dircache_used(get_block<DirCacheBlock>(dc_block)) + len <= sizeof(DirCacheBlock::records)) {
+                target = dc_block;
+                break;
+            }
+        }
+        if (target == 0) {
+            target = new_dircache_block(dir_block);
+            if (target == 0) return false;
+            auto* last = get_block_writable<DirCacheBlock>(chain.back());
+            if (last) set_checksummed(last, last->next_dirc, target);
+        }
+        
+        auto* dc = get_block_writable<DirCacheBlock>(target);
+        if (!dc) return false;
+        std::memcpy(dc->records + *dircache_used(dc), rec.data(), len);
+        dc->records_nb = endian::to_big_endian(endian::from_big_endian(dc->records_nb) + 1);
+        update_checksum(dc);
+        return true;
+    }
+    
+    // requires dir_lock(dir_block) held exclusively, or fs_mutex_ held exclusively.
+    // Closes the gap left by the record. A block left empty is unlinked and
+    // freed; the first block stays put, since the header points at it, and
+    // takes over its successor's records instead.
+    void remove_dircache_record(uint32_t dir_block, uint32_t file_block) {
+        std::lock_guard<std::mutex> lock(dircache_mutex_);
+        auto chain = dircache_chain(dir_block);
         
-        while (current != 0) {
-            auto* block = get_block_writable<FileBlock>(current);
-            if (!block) break;
+        for (size_t i = 0; i < chain.size(); ++i) {
+            auto* dc = get_block_writable<DirCacheBlock>(chain[i]);
+            if (!dc) return;
+            auto off = find_dircache_record(dc, file_block);
+            if (!off) continue;
             
-            uint32_t next = endian::from_big_endian(block->hash_chain);
-            if (next == target_block) {
-                // Found it - unlink with proper endian conversion
-                uint32_t next2 = 0;
-                if (auto* target = get_block<FileBlock>(target_block)) {
-                    next2 = endian::from_big_endian(target->hash_chain);
+            size_t used = *dircache_used(dc);
+            size_t len = dircache_record_len(dc->records + *off, sizeof(dc->records) - *off);
+            std::memmove(dc->records + *off, dc->records + *off + len, used - *off - len);
+            std::memset(dc->records + used - len, 0, len);
+            uint32_t count = endian::from_big_endian(dc->records_nb) - 1;
+            dc->records_nb = endian::to_big_endian(count);
+            
+            uint32_t next = endian::from_big_endian(dc->next_dirc);
+            if (count == 0 && i > 0) {
+                auto* prev = get_block_writable<DirCacheBlock>(chain[i - 1]);
+                if (prev) {
+                    set_checksummed(prev, prev->next_dirc, next);
+                    free_block(chain[i]);
+                    return;
+                }
+            } else if (count == 0 && next != 0) {
+                // A link past the end of the image is left as it is
+                if (const auto* succ = get_block<DirCacheBlock>(next)) {
+                    std::memcpy(dc->records, succ->records, sizeof(dc->records));
+                    dc->records_nb = succ->records_nb;
+                    dc->next_dirc = succ->next_dirc;
+                    free_block(next);
                 }
-                block->hash_chain = endian::to_big_endian(next2);
-                update_checksum(block);
-                return true;
             }
+            update_checksum(dc);
+            return;
+        }
+    }
+    
+    // requires header_lock(file_block) held.
+    // Rewrites the size, protection and date of file_block's record in place;
+    // those fields have a fixed width, so the record never moves.
+    void update_dircache_record(uint32_t dir_block, uint32_t file_block, const FileBlock* fb) {
+        std::array<uint8_t, DIRC_RECORD_MAX> rec;
+        make_dircache_record(file_block, fb, rec.data());
+        
+        std::lock_guard<std::mutex> lock(dircache_mutex_);
+        for (uint32_t dc_block : dircache_chain(dir_block)) {
+            const auto* dc = get_block<DirCacheBlock>(dc_block);
+            auto off = find_dircache_record(dc, file_block);
+            if (!off) continue;
             
-            current = next;
+            // header through ticks
+            if (std::memcmp(dc->records + *off, rec.data(), 22) == 0) return;
+            auto* writable = get_block_writable<DirCacheBlock>(dc_block);
+            if (!writable) return;
+            std::memcpy(writable->records + *off, rec.data(), 22);
+            update_checksum(writable);
+            return;
+        }
+    }
+    
+    // requires fs_mutex_ held exclusively
+    void free_dircache_chain(uint32_t dir_block) {
+        std::lock_guard<std::mutex> lock(dircache_mutex_);
+        for (uint32_t dc_block : dircache_chain(dir_block)) {
+            free_block(dc_block);
         }
-        return false;
     }
     
     time_t amiga_to_unix_time(uint32_t days, uint32_t mins, uint32_t ticks) {
@@ -1538,71 +3011,101 @@ private:
         return {days, mins, ticks};
     }
     
+    // Timestamp helpers keep the header checksum valid via delta updates
     void touch_fileblock(FileBlock* fb, time_t t = time(nullptr)) {
         auto [d, m, ticks] = unix_to_amiga_time(t);
-        fb->days  = endian::to_big_endian(d);
-        fb->mins  = endian::to_big_endian(m);
-        fb->ticks = endian::to_big_endian(ticks);
+        set_checksummed(fb, fb->days, d);
+        set_checksummed(fb, fb->mins, m);
+        set_checksummed(fb, fb->ticks, ticks);
     }
     
     void touch_rootblock(RootBlock* rb, time_t t = time(nullptr)) {
         auto [d, m, ticks] = unix_to_amiga_time(t);
-        rb->days  = endian::to_big_endian(d);
-        rb->mins  = endian::to_big_endian(m);
-        rb->ticks = endian::to_big_endian(ticks);
+        set_checksummed(rb, rb->days, d);
+        set_checksummed(rb, rb->mins, m);
+        set_checksummed(rb, rb->ticks, ticks);
     }
 };
 
 // Global ADF image
 static std::unique_ptr<AdfImage> g_adf_image;
 
-// Standard FUSE operations with write support
-namespace fuse_ops {
-
-static int getattr(const char* path, struct stat* stbuf) {
+// Attribute helpers shared by both FUSE backends
+static void fill_stat(const Entry& entry, struct stat* stbuf) {
     std::memset(stbuf, 0, sizeof(struct stat));
     
-    if (!g_adf_image) return -EIO;
-    
-    auto entry = g_adf_image->get_entry(path);
-    if (!entry) return -ENOENT;
-    
     // Use stable inode based on block number
-    stbuf->st_ino = entry->block_num ? entry->block_num : 2;
+    stbuf->st_ino = entry.block_num ? entry.block_num : 2;
     
-    if (entry->is_directory) {
+    if (entry.is_directory) {
         stbuf->st_mode = S_IFDIR | (g_adf_image->is_read_only() ? 0555 : 0755);
         
-        // Calculate st_nlink = 2 + subdirectory count for picky tools
-        auto entries = g_adf_image->list_directory(path);
-        nlink_t subdir_count = 0;
-        if (entries) {
-            for (const auto& e : *entries) {
-                if (e.is_directory) subdir_count++;
-            }
-        }
-        stbuf->st_nlink = 2 + subdir_count;
+        // st_nlink = 2 + subdirectory count for picky tools
+        stbuf->st_nlink = 2 + entry.subdirs;
         stbuf->st_size = 0;
     } else {
         stbuf->st_mode = S_IFREG | (g_adf_image->is_read_only() ? 0444 : 0644);
         stbuf->st_nlink = 1;
-        
-        // Get actual file size from file block, not cached directory entry
-        size_t actual_size = g_adf_image->get_actual_file_size(entry->block_num);
-        stbuf->st_size = static_cast<off_t>(actual_size);
+        stbuf->st_size = static_cast<off_t>(entry.size);
     }
     
     stbuf->st_uid = getuid();
     stbuf->st_gid = getgid();
     
-    time_t mtime = entry->mtime;
+    time_t mtime = entry.mtime;
     stbuf->st_atime = mtime;
     stbuf->st_mtime = mtime;
     stbuf->st_ctime = mtime;
     
     stbuf->st_blocks = (stbuf->st_size + 511) / 512;
     stbuf->st_blksize = 512;
+}
+
+static void fill_statvfs(struct statvfs* stbuf) {
+    std::memset(stbuf, 0, sizeof(*stbuf));
+    stbuf->f_bsize  = amiga_fuse::BLOCK_SIZE;
+    stbuf->f_frsize = amiga_fuse::BLOCK_SIZE;
+    const auto total = g_adf_image->total_blocks();
+    const auto free  = g_adf_image->free_blocks_count();
+    stbuf->f_blocks = static_cast<fsblkcnt_t>(total);
+    stbuf->f_bfree  = static_cast<fsblkcnt_t>(free);
+    stbuf->f_bavail = static_cast<fsblkcnt_t>(free);
+    // crude but consistent with a flat FS without inode accounting
+    stbuf->f_files  = static_cast<fsfilcnt_t>(total);
+    stbuf->f_ffree  = static_cast<fsfilcnt_t>(free);
+    stbuf->f_namemax = amiga_fuse::BCPL_STRING_MAX; // 30
+}
+
+// Shared by both backends: only plain preallocation and FALLOC_FL_KEEP_SIZE
+// make sense here, there are no holes to punch or ranges to collapse
+static int preallocate(uint32_t block_num, int mode, off_t offset, off_t length) {
+    if (offset < 0 || length <= 0) return -EINVAL;
+    
+    bool keep_size = false;
+#ifdef FALLOC_FL_KEEP_SIZE
+    keep_size = (mode & FALLOC_FL_KEEP_SIZE) != 0;
+    mode &= ~FALLOC_FL_KEEP_SIZE;
+#endif
+    if (mode != 0) return -EOPNOTSUPP;
+    
+    return g_adf_image->allocate_file_at(block_num, static_cast<size_t>(offset),
+                                         static_cast<size_t>(length), keep_size);
+}
+
+#ifndef AMIGA_FUSE_LOWLEVEL
+
+// Standard FUSE operations with write support
+namespace fuse_ops {
+
+static int getattr(const char* path, struct stat* stbuf) {
+    std::memset(stbuf, 0, sizeof(struct stat));
+    
+    if (!g_adf_image) return -EIO;
+    
+    auto entry = g_adf_image->get_entry(path);
+    if (!entry) return -ENOENT;
     
+    fill_stat(*entry, stbuf);
     return 0;
 }
 
@@ -1616,8 +3119,11 @@ static int readdir(const char* path, void* buf, fuse_fill_dir_t filler,
     if (filler(buf, ".",  nullptr, 0) != 0) return 0;
     if (filler(buf, "..", nullptr, 0) != 0) return 0;
 
+    // The listing already read every header, so hand the attributes along
+    struct stat st;
     for (const auto& entry : *entries) {
-        if (filler(buf, entry.name.c_str(), nullptr, 0) != 0) break;
+        fill_stat(entry, &st);
+        if (filler(buf, entry.name.c_str(), &st, 0) != 0) break;
     }
     return 0;
 }
@@ -1636,7 +3142,6 @@ static int open(const char* path, struct fuse_file_info* fi) {
     if (!g_adf_image->is_read_only() && (fi->flags & O_TRUNC)) {
         int r = g_adf_image->truncate_file(path, 0);
         if (r) return r;
-        g_adf_image->clear_cache();
     }
 
     fi->fh = entry->block_num;
@@ -1687,11 +3192,6 @@ static int write(const char* path, const char* buf, size_t size, off_t offset,
     
     DBG(std::cerr << "DEBUG: write returned " << result << " bytes (requested " << size << ")" << std::endl);
     
-    // Clear directory cache so getattr reports updated file size
-    if (result > 0) {
-        g_adf_image->clear_cache();
-    }
-    
     return result;
 }
 
@@ -1712,7 +3212,7 @@ static int create(const char* path, mode_t mode, struct fuse_file_info* fi) {
         } else {
             DBG(std::cerr << "DEBUG: WARNING: File created but can't get entry!" << std::endl);
         }
-        g_adf_image->sync_to_disk();
+        g_adf_image->sync_after_op();
     }
     
     return result;
@@ -1724,8 +3224,7 @@ static int unlink(const char* path) {
     int result = g_adf_image->delete_file(path);
     
     if (result == 0) {
-        g_adf_image->clear_cache();
-        g_adf_image->sync_to_disk();
+        g_adf_image->sync_after_op();
     }
     return result;
 }
@@ -1739,12 +3238,24 @@ static int truncate(const char* path, off_t size) {
     // Guard against 32-bit overflow
     if (size > std::numeric_limits<uint32_t>::max()) return -EFBIG;
     
-    int result = g_adf_image->truncate_file(path, size);
-    if (result == 0) {
-        g_adf_image->clear_cache();
+    return g_adf_image->truncate_file(path, size);
+}
+
+#if FUSE_VERSION >= 29
+static int fallocate(const char* path, int mode, off_t offset, off_t length,
+                     struct fuse_file_info* fi) {
+    if (!g_adf_image) return -EIO;
+    
+    uint32_t block_num = fi ? static_cast<uint32_t>(fi->fh) : 0;
+    if (block_num == 0) {
+        auto entry = g_adf_image->get_entry(path);
+        if (!entry || entry->is_directory) return -ENOENT;
+        block_num = entry->block_num;
     }
-    return result;
+    
+    return preallocate(block_num, mode, offset, length);
 }
+#endif
 
 static int mkdir(const char* path, mode_t mode) {
     if (!g_adf_image) return -EIO;
@@ -1755,22 +3266,37 @@ static int rmdir(const char* path) {
     if (!g_adf_image) return -EIO;
     int result = g_adf_image->delete_directory(path);
     if (result == 0) {
-        g_adf_image->clear_cache();
-        g_adf_image->sync_to_disk();
+        g_adf_image->sync_after_op();
     }
     return result;
 }
 
 static int fsync(const char*, int, struct fuse_file_info*) {
-    if (g_adf_image) g_adf_image->sync_to_disk();
+    if (g_adf_image) g_adf_image->sync_on_fsync();
     return 0;
 }
 
 static int flush(const char*, struct fuse_file_info*) {
-    if (g_adf_image) g_adf_image->sync_to_disk();
+    if (g_adf_image) g_adf_image->sync_after_op();
     return 0;
 }
 
+// Runs in the mounted (possibly daemonized) process, so background work starts here
+static void* init(struct fuse_conn_info*) {
+    if (g_adf_image) {
+        g_adf_image->start_periodic_commit();
+        g_adf_image->start_background_check();
+    }
+    return nullptr;
+}
+
+static void destroy(void*) {
+    if (g_adf_image) {
+        g_adf_image->stop_background_check();
+        g_adf_image->stop_periodic_commit();
+    }
+}
+
 // Add mknod shim for maximum tool compatibility
 // Some callers do mknod + open instead of create
 static int mknod(const char* path, mode_t mode, dev_t) {
@@ -1809,18 +3335,7 @@ static int utimens(const char* path, const struct timespec tv[2]) {
 static int statfs(const char*, struct statvfs* stbuf) {
     if (!g_adf_image) return -EIO;
     
-    std::memset(stbuf, 0, sizeof(*stbuf));
-    stbuf->f_bsize  = amiga_fuse::BLOCK_SIZE;
-    stbuf->f_frsize = amiga_fuse::BLOCK_SIZE;
-    const auto total = g_adf_image->total_blocks();
-    const auto free  = g_adf_image->free_blocks_count();
-    stbuf->f_blocks = static_cast<fsblkcnt_t>(total);
-    stbuf->f_bfree  = static_cast<fsblkcnt_t>(free);
-    stbuf->f_bavail = static_cast<fsblkcnt_t>(free);
-    // crude but consistent with a flat FS without inode accounting
-    stbuf->f_files  = static_cast<fsfilcnt_t>(total);
-    stbuf->f_ffree  = static_cast<fsfilcnt_t>(free);
-    stbuf->f_namemax = amiga_fuse::BCPL_STRING_MAX; // 30
+    fill_statvfs(stbuf);
     return 0;
 }
 
@@ -1838,6 +3353,9 @@ void initialize_fuse_operations() {
     amiga_fuse_operations.create = fuse_ops::create;
     amiga_fuse_operations.unlink = fuse_ops::unlink;
     amiga_fuse_operations.truncate = fuse_ops::truncate;
+#if FUSE_VERSION >= 29
+    amiga_fuse_operations.fallocate = fuse_ops::fallocate;
+#endif
     amiga_fuse_operations.mkdir = fuse_ops::mkdir;
     amiga_fuse_operations.rmdir = fuse_ops::rmdir;
     amiga_fuse_operations.flush = fuse_ops::flush;
@@ -1847,11 +3365,437 @@ void initialize_fuse_operations() {
     amiga_fuse_operations.chown = fuse_ops::chown;
     amiga_fuse_operations.utimens = fuse_ops::utimens;
     amiga_fuse_operations.statfs = fuse_ops::statfs;
+    amiga_fuse_operations.init = fuse_ops::init;
+    amiga_fuse_operations.destroy = fuse_ops::destroy;
+}
+
+static int run_fuse(struct fuse_args* args) {
+    initialize_fuse_operations();
+    return fuse_main(args->argc, args->argv, &amiga_fuse_operations, nullptr);
+}
+
+#else // AMIGA_FUSE_LOWLEVEL
+
+// FUSE 3 low-level operations. The inode number is the header block number,
+// so every request goes straight to its block without resolving a path.
+namespace fuse_ll_ops {
+
+constexpr double ATTR_TIMEOUT = 1.0;
+constexpr double ENTRY_TIMEOUT = 1.0;
+
+static uint32_t to_block(fuse_ino_t ino) {
+    return ino == FUSE_ROOT_ID ? g_adf_image->root_block() : static_cast<uint32_t>(ino);
+}
+
+static fuse_ino_t to_ino(uint32_t block) {
+    return block == g_adf_image->root_block() ? FUSE_ROOT_ID : static_cast<fuse_ino_t>(block);
+}
+
+static void fill_attr(const Entry& entry, struct stat* stbuf) {
+    fill_stat(entry, stbuf);
+    stbuf->st_ino = to_ino(entry.block_num);
+}
+
+static void fill_entry_param(const Entry& entry, struct fuse_entry_param* e) {
+    std::memset(e, 0, sizeof(*e));
+    e->ino = to_ino(entry.block_num);
+    e->generation = g_adf_image->generation(entry.block_num);
+    e->attr_timeout = ATTR_TIMEOUT;
+    e->entry_timeout = ENTRY_TIMEOUT;
+    fill_attr(entry, &e->attr);
+}
+
+static void init(void*, struct fuse_conn_info* conn) {
+    // Read replies are vectors of many small spans; with splice libfuse
+    // feeds them through a pipe instead of first gathering them into one
+    // temporary buffer
+    if (conn->capable & FUSE_CAP_SPLICE_WRITE) conn->want |= FUSE_CAP_SPLICE_WRITE;
+    if (g_adf_image) {
+        g_adf_image->start_periodic_commit();
+        g_adf_image->start_background_check();
+    }
+}
+
+static void destroy(void*) {
+    if (g_adf_image) {
+        g_adf_image->stop_background_check();
+        g_adf_image->stop_periodic_commit();
+    }
+}
+
+static void lookup(fuse_req_t req, fuse_ino_t parent, const char* name) {
+    auto entry = g_adf_image->lookup_at(to_block(parent), name);
+    if (!entry) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    
+    struct fuse_entry_param e;
+    fill_entry_param(*entry, &e);
+    fuse_reply_entry(req, &e);
+}
+
+// Inodes are block numbers with no per-lookup state to release
+static void forget(fuse_req_t req, fuse_ino_t, uint64_t) {
+    fuse_reply_none(req);
+}
+
+static void getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info*) {
+    auto entry = g_adf_image->get_entry_at(to_block(ino));
+    if (!entry) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    
+    struct stat st;
+    fill_attr(*entry, &st);
+    fuse_reply_attr(req, &st, ATTR_TIMEOUT);
+}
+
+static void setattr(fuse_req_t req, fuse_ino_t ino, struct stat* attr, int to_set,
+                    struct fuse_file_info*) {
+    uint32_t block = to_block(ino);
+    
+    // Only size is meaningful; mode, owner and times are accepted and ignored
+    // like the chmod/chown/utimens shims of the high-level backend
+    if (to_set & FUSE_SET_ATTR_SIZE) {
+        if (attr->st_size < 0) {
+            fuse_reply_err(req, EINVAL);
+            return;
+        }
+        if (attr->st_size > std::numeric_limits<uint32_t>::max()) {
+            fuse_reply_err(req, EFBIG);
+            return;
+        }
+        int r = g_adf_image->truncate_file_at(block, attr->st_size);
+        if (r) {
+            fuse_reply_err(req, -r);
+            return;
+        }
+    }
+    
+    getattr(req, ino, nullptr);
+}
+
+// Shared by readdir and readdirplus. With plus, every entry carries full
+// attributes and timeouts, so the kernel needs no lookup or getattr for it.
+static void reply_directory(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, bool plus) {
+    auto entries = g_adf_image->list_directory_at(to_block(ino));
+    if (!entries) {
+        fuse_reply_err(req, ENOTDIR);
+        return;
+    }
+    
+    // Offsets are positions: 0 = ".", 1 = "..", 2 + i = entries[i]
+    std::vector<char> buf(size);
+    size_t used = 0;
+    for (size_t pos = static_cast<size_t>(off); pos < entries->size() + 2; ++pos) {
+        struct fuse_entry_param e;
+        std::memset(&e, 0, sizeof(e));
+        const char* name;
+        if (pos < 2) {
+            // ino 0: no attributes and no lookup count for the dot entries
+            name = pos == 0 ? "." : "..";
+            e.attr.st_ino = ino;
+            e.attr.st_mode = S_IFDIR;
+        } else {
+            const Entry& entry = (*entries)[pos - 2];
+            name = entry.name.c_str();
+            if (plus) {
+                fill_entry_param(entry, &e);
+            } else {
+                e.attr.st_ino = to_ino(entry.block_num);
+                e.attr.st_mode = entry.is_directory ? S_IFDIR : S_IFREG;
+            }
+        }
+        
+        size_t need = plus ?
+            fuse_add_direntry_plus(req, buf.data() + used, size - used, name, &e,
+                                   static_cast<off_t>(pos + 1)) :
+            fuse_add_direntry(req, buf.data() + used, size - used, name, &e.attr,
+                              static_cast<off_t>(pos + 1));
+        if (need > size - used) break;
+        used += need;
+    }
+    fuse_reply_buf(req, buf.data(), used);
+}
+
+static void readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                    struct fuse_file_info*) {
+    reply_directory(req, ino, size, off, false);
+}
+
+static void readdirplus(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
+                        struct fuse_file_info*) {
+    reply_directory(req, ino, size, off, true);
+}
+
+static void open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) {
+    uint32_t block = to_block(ino);
+    if (g_adf_image->is_read_only() && (fi->flags & O_ACCMODE) != O_RDONLY) {
+        fuse_reply_err(req, EROFS);
+        return;
+    }
+    
+    // Pins the file's blocks until release, even if it is unlinked meanwhile
+    int r = g_adf_image->open_file(block);
+    if (r) {
+        fuse_reply_err(req, -r);
+        return;
+    }
+    
+    // Handle O_TRUNC flag - some tools open with truncate instead of calling truncate(2) explicitly
+    if (!g_adf_image->is_read_only() && (fi->flags & O_TRUNC)) {
+        r = g_adf_image->truncate_file_at(block, 0);
+        if (r) {
+            g_adf_image->release_file(block);
+            fuse_reply_err(req, -r);
+            return;
+        }
+    }
+    
+    fi->fh = block;
+    fuse_reply_open(req, fi);
+}
+
+static void release(fuse_req_t req, fuse_ino_t, struct fuse_file_info* fi) {
+    g_adf_image->release_file(static_cast<uint32_t>(fi->fh));
+    fuse_reply_err(req, 0);
+}
+
+static void read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t offset,
+                 struct fuse_file_info*) {
+    if (offset < 0) {
+        fuse_reply_err(req, EINVAL);
+        return;
+    }
+    
+    // Zero-copy: reply straight from the mapped image. fuse_reply_data has
+    // copied the data into the kernel by the time it returns.
+    int r = g_adf_image->reply_file_bufvec(to_block(ino), static_cast<size_t>(offset), size,
+                                           [req](struct fuse_bufvec* vec) {
+        fuse_reply_data(req, vec, FUSE_BUF_SPLICE_MOVE);
+    });
+    if (r) fuse_reply_err(req, -r);
+}
+
+static void write(fuse_req_t req, fuse_ino_t ino, const char* buf, size_t size, off_t offset,
+                  struct fuse_file_info*) {
+    // Guard against negative offsets and 32-bit overflow at FUSE boundary
+    if (offset < 0) {
+        fuse_reply_err(req, EINVAL);
+        return;
+    }
+    if (add_would_overflow_u32(static_cast<size_t>(offset), size)) {
+        fuse_reply_err(req, EFBIG);
+        return;
+    }
+    
+    int result = g_adf_image->write_file(to_block(ino), buf, size, static_cast<size_t>(offset));
+    if (result < 0) {
+        fuse_reply_err(req, -result);
+        return;
+    }
+    fuse_reply_write(req, static_cast<size_t>(result));
+}
+
+// Creates a file or directory and replies with its entry (and open handle if fi is set)
+static void make_entry(fuse_req_t req, fuse_ino_t parent, const char* name, bool directory,
+                       struct fuse_file_info* fi) {
+    uint32_t block = 0;
+    int r = directory ?
+        g_adf_image->create_directory_at(to_block(parent), name, block) :
+        g_adf_image->create_file_at(to_block(parent), name, block);
+    if (r) {
+        fuse_reply_err(req, -r);
+        return;
+    }
+    
+    auto entry = g_adf_image->get_entry_at(block);
+    if (!entry) {
+        fuse_reply_err(req, EIO);
+        return;
+    }
+    
+    struct fuse_entry_param e;
+    fill_entry_param(*entry, &e);
+    
+    if (fi) {
+        r = g_adf_image->open_file(block);
+        if (r) {
+            fuse_reply_err(req, -r);
+            return;
+        }
+        fi->fh = block;
+        g_adf_image->sync_after_op();
+        fuse_reply_create(req, &e, fi);
+    } else {
+        fuse_reply_entry(req, &e);
+    }
+}
+
+static void create(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t,
+                   struct fuse_file_info* fi) {
+    make_entry(req, parent, name, false, fi);
+}
+
+// Some callers do mknod + open instead of create
+static void mknod(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t mode, dev_t) {
+    // Only support regular files (S_IFREG)
+    if (!S_ISREG(mode)) {
+        fuse_reply_err(req, EPERM);
+        return;
+    }
+    make_entry(req, parent, name, false, nullptr);
+}
+
+static void mkdir(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t) {
+    make_entry(req, parent, name, true, nullptr);
+}
+
+static void unlink(fuse_req_t req, fuse_ino_t parent, const char* name) {
+    int result = g_adf_image->delete_file_at(to_block(parent), name);
+    if (result == 0) {
+        g_adf_image->sync_after_op();
+    }
+    fuse_reply_err(req, -result);
+}
+
+static void rmdir(fuse_req_t req, fuse_ino_t parent, const char* name) {
+    int result = g_adf_image->delete_directory_at(to_block(parent), name);
+    if (result == 0) {
+        g_adf_image->sync_after_op();
+    }
+    fuse_reply_err(req, -result);
+}
+
+static void fallocate(fuse_req_t req, fuse_ino_t ino, int mode, off_t offset, off_t length,
+                      struct fuse_file_info*) {
+    fuse_reply_err(req, -preallocate(to_block(ino), mode, offset, length));
+}
+
+static void flush(fuse_req_t req, fuse_ino_t, struct fuse_file_info*) {
+    g_adf_image->sync_after_op();
+    fuse_reply_err(req, 0);
+}
+
+static void fsync(fuse_req_t req, fuse_ino_t, int, struct fuse_file_info*) {
+    g_adf_image->sync_on_fsync();
+    fuse_reply_err(req, 0);
+}
+
+static void statfs(fuse_req_t req, fuse_ino_t) {
+    struct statvfs st;
+    fill_statvfs(&st);
+    fuse_reply_statfs(req, &st);
+}
+
+} // namespace fuse_ll_ops
+
+static struct fuse_lowlevel_ops amiga_fuse_ll_operations = {};
+
+void initialize_fuse_operations() {
+    amiga_fuse_ll_operations.init = fuse_ll_ops::init;
+    amiga_fuse_ll_operations.destroy = fuse_ll_ops::destroy;
+    amiga_fuse_ll_operations.lookup = fuse_ll_ops::lookup;
+    amiga_fuse_ll_operations.forget = fuse_ll_ops::forget;
+    amiga_fuse_ll_operations.getattr = fuse_ll_ops::getattr;
+    amiga_fuse_ll_operations.setattr = fuse_ll_ops::setattr;
+    amiga_fuse_ll_operations.readdir = fuse_ll_ops::readdir;
+    amiga_fuse_ll_operations.readdirplus = fuse_ll_ops::readdirplus;
+    amiga_fuse_ll_operations.open = fuse_ll_ops::open;
+    amiga_fuse_ll_operations.release = fuse_ll_ops::release;
+    amiga_fuse_ll_operations.read = fuse_ll_ops::read;
+    amiga_fuse_ll_operations.write = fuse_ll_ops::write;
+    amiga_fuse_ll_operations.fallocate = fuse_ll_ops::fallocate;
+    amiga_fuse_ll_operations.create = fuse_ll_ops::create;
+    amiga_fuse_ll_operations.mknod = fuse_ll_ops::mknod;
+    amiga_fuse_ll_operations.mkdir = fuse_ll_ops::mkdir;
+    amiga_fuse_ll_operations.unlink = fuse_ll_ops::unlink;
+    amiga_fuse_ll_operations.rmdir = fuse_ll_ops::rmdir;
+    amiga_fuse_ll_operations.flush = fuse_ll_ops::flush;
+    amiga_fuse_ll_operations.fsync = fuse_ll_ops::fsync;
+    amiga_fuse_ll_operations.statfs = fuse_ll_ops::statfs;
+}
+
+// Equivalent of fuse_main for the low-level API
+static int run_fuse(struct fuse_args* args) {
+    struct fuse_cmdline_opts opts;
+    if (fuse_parse_cmdline(args, &opts) != 0) return 1;
+    
+    if (opts.show_help) {
+        fuse_cmdline_help();
+        fuse_lowlevel_help();
+        std::free(opts.mountpoint);
+        return 0;
+    }
+    if (opts.show_version) {
+        fuse_lowlevel_version();
+        std::free(opts.mountpoint);
+        return 0;
+    }
+    if (!opts.mountpoint) {
+        std::cerr << "Error: no mount point specified\n";
+        return 1;
+    }
+    
+    initialize_fuse_operations();
+    
+    int result = 1;
+    struct fuse_session* se = fuse_session_new(args, &amiga_fuse_ll_operations,
+                                               sizeof(amiga_fuse_ll_operations), nullptr);
+    if (se) {
+        if (fuse_set_signal_handlers(se) == 0) {
+            if (fuse_session_mount(se, opts.mountpoint) == 0) {
+                fuse_daemonize(opts.foreground);
+                if (opts.singlethread) {
+                    result = fuse_session_loop(se);
+                } else {
+                    struct fuse_loop_config config;
+                    config.clone_fd = opts.clone_fd;
+                    config.max_idle_threads = opts.max_idle_threads;
+                    result = fuse_session_loop_mt(se, &config);
+                }
+                fuse_session_unmount(se);
+            }
+            fuse_remove_signal_handlers(se);
+        }
+        fuse_session_destroy(se);
+    }
+    
+    std::free(opts.mountpoint);
+    return result ? 1 : 0;
+}
+
+#endif // AMIGA_FUSE_LOWLEVEL
+
+// Driver-specific mount options, parsed out before FUSE sees them
+struct MountOptions {
+    char* durability = nullptr;
+    unsigned commit_ms = 5000;
+    int fragstats = 0;
+};
+
+static const struct fuse_opt amiga_fuse_opts[] = {
+    { "durability=%s", offsetof(MountOptions, durability), 0 },
+    { "commit_ms=%u", offsetof(MountOptions, commit_ms), 0 },
+    { "fragstats", offsetof(MountOptions, fragstats), 1 },
+    FUSE_OPT_END
+};
+
+// Result of the background bitmap check, which only runs when the bitmap was trusted
+static void print_fragmentation(const char* when) {
+    const auto stats = g_adf_image->fragmentation();
+    report(LOG_INFO, "Fragmentation " + std::string(when) + ": " + std::to_string(stats.fragmented_files) +
+           " of " + std::to_string(stats.files) + " files fragmented, " + std::to_string(stats.extents) +
+           " extents over " + std::to_string(stats.data_blocks) + " data blocks; free space in " +
+           std::to_string(stats.free_extents) + " runs, largest " +
+           std::to_string(stats.largest_free_run) + " blocks");
 }
 
 } // namespace amiga_fuse
 
-// Rely on FUSE's own signal handling; we sync after fuse_main returns.
+// Rely on FUSE's own signal handling; we sync after the session loop returns.
 
 int main(int argc, char* argv[]) {
     using namespace amiga_fuse;
@@ -1859,9 +3803,15 @@ int main(int argc, char* argv[]) {
     if (argc < 3) {
         std::cerr << "Usage: " << argv[0] << " <adf_file> <mount_point> [fuse_options]\n";
         std::cerr << "  Note: ADF filesystems require write access for proper operation\n";
+        std::cerr << "  Options:\n";
+        std::cerr << "    -o durability=strict|periodic|fsync|unmount  when to commit changes (default: strict)\n";
+        std::cerr << "    -o commit_ms=N                               periodic commit interval (default: 5000)\n";
+        std::cerr << "    -o fragstats                                 report file and free-space fragmentation at mount and unmount\n";
         return 1;
     }
     
+    openlog("amiga-fuse", LOG_PID, LOG_USER);
+    
     // ADF filesystems require write access even for reading operations
     // due to internal filesystem bookkeeping (checksums, metadata, etc.)
     bool enable_write = true;
@@ -1879,6 +3829,9 @@ int main(int argc, char* argv[]) {
     if (g_adf_image->is_ffs()) {
         std::cout << " (FFS)";
     }
+    if (g_adf_image->has_dircache()) {
+        std::cout << " (dircache)";
+    }
     if (g_adf_image->is_read_only()) {
         std::cout << " [READ-ONLY]";
     } else {
@@ -1886,15 +3839,31 @@ int main(int argc, char* argv[]) {
     }
     std::cout << "\n";
     
-    // Initialize FUSE operations structure
-    initialize_fuse_operations();
-    
     // Adjust arguments for FUSE - safely shift arguments
     std::memmove(argv + 1, argv + 2, (argc - 2) * sizeof(char*));
     --argc;
     argv[argc] = nullptr; // now argv = [prog, mount_point, ...fuse_options]
     
-    int result = fuse_main(argc, argv, &amiga_fuse_operations, nullptr);
+    // Strip our own -o options; everything else goes to FUSE untouched
+    struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
+    MountOptions options;
+    if (fuse_opt_parse(&args, &options, amiga_fuse_opts, nullptr) == -1) {
+        return 1;
+    }
+    
+    auto durability = parse_durability(options.durability ? options.durability : "strict");
+    std::free(options.durability);
+    if (!durability) {
+        std::cerr << "Error: Unknown durability mode (use strict, periodic, fsync or unmount)\n";
+        fuse_opt_free_args(&args);
+        return 1;
+    }
+    g_adf_image->set_durability(*durability, options.commit_ms);
+    if (options.fragstats) print_fragmentation("at mount");
+    
+    int result = run_fuse(&args);
+    fuse_opt_free_args(&args);
+    if (options.fragstats) print_fragmentation("at unmount");
     
     // Clean shutdown
     if (g_adf_image) {
@@ -0,0 +1,81 @@
+// Shared by the benchmarks that drive a mounted image: compiles the driver
+// in with its main renamed and formats blank images to run against.
+
+#pragma once
+
+#define main amiga_fuse_main
+#include "../amiga-fuse.cpp"
+#undef main
+
+#include <chrono>
+#include <cstdio>
+
+using namespace amiga_fuse;
+
+// Stores the value that makes the block's 128 words sum to zero
+inline void bench_checksum(void* block, size_t checksum_word) {
+    auto* words = static_cast<uint32_t*>(block);
+    words[checksum_word] = 0;
+    words[checksum_word] = endian::to_big_endian(0u - checksum::block_sum(block));
+}
+
+// Writes a blank volume of the given size: root block in the middle, its
+// bitmap pages right after it and extension blocks after those if the
+// volume needs more than the root's 25. Bitmap bit n of page i maps block
+// BM_FIRST + i * BM_PAGE_BLOCKS + n, as AmigaDOS lays it out.
+inline bool format_image(const char* path, uint32_t blocks, uint32_t dostype) {
+    std::vector<uint8_t> image(size_t(blocks) * BLOCK_SIZE, 0);
+    auto block = [&](uint32_t n) { return image.data() + size_t(n) * BLOCK_SIZE; };
+
+    uint32_t root_num = blocks / 2;
+    uint32_t pages = (blocks - BM_FIRST + BM_PAGE_BLOCKS - 1) / BM_PAGE_BLOCKS;
+    uint32_t exts = pages > 25 ? (pages - 25 + 126) / 127 : 0;
+    uint32_t last_used = root_num + pages + exts;
+
+    *reinterpret_cast<uint32_t*>(block(0)) = endian::to_big_endian(dostype);
+
+    auto* root = reinterpret_cast<RootBlock*>(block(root_num));
+    root->type = endian::to_big_endian(static_cast<uint32_t>(T_HEADER));
+    root->hash_table_size = endian::to_big_endian(static_cast<uint32_t>(HASH_TABLE_SIZE));
+    root->sec_type = endian::to_big_endian(ST_ROOT);
+    root->bm_flag = endian::to_big_endian(BM_VALID);
+    BcplString::write(root->name, "Bench");
+
+    for (uint32_t i = 0; i < pages; i++) {
+        uint32_t page_num = root_num + 1 + i;
+        if (i < 25) {
+            root->bm_pages[i] = endian::to_big_endian(page_num);
+        } else {
+            uint32_t ext = root_num + 1 + pages + (i - 25) / 127;
+            reinterpret_cast<BitmapExtBlock*>(block(ext))->bm_pages[(i - 25) % 127] =
+                endian::to_big_endian(page_num);
+        }
+
+        auto* page = reinterpret_cast<BitmapBlock*>(block(page_num));
+        for (uint32_t word = 0; word < 127; word++) {
+            uint32_t map = 0;
+            for (uint32_t bit = 0; bit < 32; bit++) {
+                uint32_t n = BM_FIRST + i * BM_PAGE_BLOCKS + word * 32 + bit;
+                if (n < blocks && (n < root_num || n > last_used)) map |= 1u << bit;
+            }
+            page->map[word] = endian::to_big_endian(map);
+        }
+        bench_checksum(page, 0);
+    }
+    for (uint32_t e = 0; e < exts; e++) {
+        uint32_t ext = root_num + 1 + pages + e;
+        uint32_t next = e + 1 < exts ? ext + 1 : 0;
+        if (e == 0) root->bm_ext = endian::to_big_endian(ext);
+        reinterpret_cast<BitmapExtBlock*>(block(ext))->bm_ext = endian::to_big_endian(next);
+    }
+    bench_checksum(root, 5);
+
+    FILE* file = std::fopen(path, "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(image.data(), 1, image.size(), file) == image.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+inline double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,54 @@
+// Block checksum microbenchmark: times each checksum kernel the build has
+// over 2 MiB of random blocks, after checking they all agree.
+//
+// Built with -DAMIGA_FUSE_BENCH=ON; run it without arguments.
+
+#define main amiga_fuse_main
+#include "../amiga-fuse.cpp"
+#undef main
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace amiga_fuse;
+
+constexpr size_t BLOCKS = 4096;
+constexpr int ROUNDS = 500;
+
+static void run(const char* name, checksum::Kernel kernel, const std::vector<uint32_t>& data) {
+    volatile uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (size_t b = 0; b < BLOCKS; b++) sink = sink + kernel(&data[b * checksum::WORDS]);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%-7s %6.1f ns/block\n", name, elapsed.count() / (ROUNDS * BLOCKS));
+}
+
+int main() {
+    std::mt19937 rng(1);
+    std::vector<uint32_t> data(BLOCKS * checksum::WORDS);
+    for (auto& word : data) word = rng();
+
+    std::vector<std::pair<const char*, checksum::Kernel>> kernels{{"scalar", checksum::sum_scalar}};
+#ifdef AMIGA_FUSE_SIMD_CHECKSUM
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) kernels.emplace_back("sse2", checksum::sum_sse2);
+    if (__builtin_cpu_supports("avx2")) kernels.emplace_back("avx2", checksum::sum_avx2);
+#endif
+
+    for (size_t b = 0; b < BLOCKS; b++) {
+        const uint32_t* block = &data[b * checksum::WORDS];
+        uint32_t expected = checksum::sum_scalar(block);
+        for (const auto& [name, kernel] : kernels) {
+            if (kernel(block) != expected) {
+                std::fprintf(stderr, "%s disagrees with scalar on block %zu\n", name, b);
+                return 1;
+            }
+        }
+    }
+
+    for (const auto& [name, kernel] : kernels) run(name, kernel, data);
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Lock contention benchmark: W writer threads each rewrite and truncate a
+// 128 KB file of their own while R reader threads read 4 KB from one of 16
+// files and list the root directory, for a few seconds on a 32 MB FFS
+// image. Prints throughput and the readers' p50/p99 latency, which is
+// what suffers when writers hold locks readers need.
+//
+// Built with -DAMIGA_FUSE_BENCH=ON; usage: contention_bench W R [seconds] [image]
+
+#include "bench_image.h"
+
+#include <algorithm>
+#include <atomic>
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::fprintf(stderr, "Usage: %s writers readers [seconds] [image]\n", argv[0]);
+        return 1;
+    }
+    int writers = std::atoi(argv[1]);
+    int readers = std::atoi(argv[2]);
+    int seconds = argc > 3 ? std::atoi(argv[3]) : 3;
+    const char* path = argc > 4 ? argv[4] : "contention_bench.adf";
+
+    if (!format_image(path, 65536, 0x444F5301)) {
+        std::fprintf(stderr, "Cannot write %s\n", path);
+        return 1;
+    }
+    AdfImage image(path);
+    if (!image.open(true)) return 1;
+    image.set_durability(Durability::Unmount, 1000);
+
+    constexpr int READ_FILES = 16;
+    std::vector<uint32_t> read_files;
+    std::vector<char> contents(64 * 1024, 'r');
+    for (int i = 0; i < READ_FILES; i++) {
+        uint32_t block = 0;
+        if (image.create_file_at(image.root_block(), "r" + std::to_string(i), block) != 0) return 1;
+        image.write_file(block, contents.data(), contents.size(), 0);
+        read_files.push_back(block);
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<long> writes{0}, reads{0};
+    std::vector<std::vector<double>> latencies(readers);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < writers; t++) {
+        threads.emplace_back([&, t] {
+            uint32_t block = 0;
+            if (image.create_file_at(image.root_block(), "w" + std::to_string(t), block) != 0) return;
+            std::vector<char> data(128 * 1024, 'w');
+            while (!stop) {
+                image.write_file(block, data.data(), data.size(), 0);
+                image.truncate_file_at(block, 0);
+                writes++;
+            }
+        });
+    }
+    for (int t = 0; t < readers; t++) {
+        threads.emplace_back([&, t] {
+            uint32_t block = read_files[t % READ_FILES];
+            while (!stop) {
+                auto start = std::chrono::steady_clock::now();
+                auto data = image.read_file(block, 0, 4096);
+                auto listing = image.list_directory("/");
+                latencies[t].push_back(elapsed_ms(start) * 1000.0);
+                reads++;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    for (auto& thread : threads) thread.join();
+
+    std::vector<double> all;
+    for (const auto& list : latencies) all.insert(all.end(), list.begin(), list.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all.empty() ? 0.0 : all[size_t(p * (all.size() - 1))]; };
+
+    std::printf("W=%d R=%d writes/s=%.0f reads/s=%.0f read p50=%.1fus p99=%.1fus\n", writers, readers,
+                double(writes) / seconds, double(reads) / seconds, percentile(0.50), percentile(0.99));
+    std::remove(path);
+    return 0;
+}